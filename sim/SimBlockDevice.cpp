@@ -0,0 +1,106 @@
+/* TSL2591 simulation, flash like block device in a file */
+
+#include "mbed.h"
+#include "BlockDevice.h"
+#include <vector>
+
+class SimBlockDevice : public BlockDevice {
+public:
+  SimBlockDevice(const char *path, bd_size_t size) : _path(path), _size(size), _file(NULL), _inits(0) {}
+
+  int init() override {
+    if (_inits++) {
+      return BD_ERROR_OK;
+    }
+    _file = fopen(_path, "r+b");
+    if (!_file) {
+      // New device, fully erased
+      _file = fopen(_path, "w+b");
+      if (!_file) {
+        _inits = 0;
+        return BD_ERROR_DEVICE_ERROR;
+      }
+      std::vector<uint8_t> erased(ERASE_SIZE, 0xFF);
+      for (bd_size_t a = 0; a < _size; a += ERASE_SIZE) {
+        fwrite(erased.data(), 1, ERASE_SIZE, _file);
+      }
+      fflush(_file);
+    }
+    return BD_ERROR_OK;
+  }
+
+  int deinit() override {
+    if (_inits && --_inits == 0) {
+      fclose(_file);
+      _file = NULL;
+    }
+    return BD_ERROR_OK;
+  }
+
+  int sync() override {
+    return (_file && fflush(_file) == 0) ? BD_ERROR_OK : BD_ERROR_DEVICE_ERROR;
+  }
+
+  int read(void *buffer, bd_addr_t addr, bd_size_t size) override {
+    if (!_file || !is_valid_read(addr, size) || fseek(_file, addr, SEEK_SET) ||
+        fread(buffer, 1, size, _file) != size) {
+      return BD_ERROR_DEVICE_ERROR;
+    }
+    return BD_ERROR_OK;
+  }
+
+  int program(const void *buffer, bd_addr_t addr, bd_size_t size) override {
+    std::vector<uint8_t> data(size);
+    if (read(data.data(), addr, size) || !is_valid_program(addr, size)) {
+      return BD_ERROR_DEVICE_ERROR;
+    }
+    // Like NOR flash, a bit once programmed to 0 stays 0 until erased
+    for (bd_size_t i = 0; i < size; i++) {
+      data[i] &= ((const uint8_t *)buffer)[i];
+    }
+    return write(data.data(), addr, size);
+  }
+
+  int erase(bd_addr_t addr, bd_size_t size) override {
+    if (!_file || !is_valid_erase(addr, size)) {
+      return BD_ERROR_DEVICE_ERROR;
+    }
+    std::vector<uint8_t> erased(size, 0xFF);
+    return write(erased.data(), addr, size);
+  }
+
+  bd_size_t get_read_size() const override { return 1; }
+  bd_size_t get_program_size() const override { return PROGRAM_SIZE; }
+  bd_size_t get_erase_size() const override { return ERASE_SIZE; }
+  int get_erase_value() const override { return 0xFF; }
+  bd_size_t size() const override { return _size; }
+  const char *get_type() const override { return "SIM"; }
+
+private:
+  static const bd_size_t PROGRAM_SIZE = 256;
+  static const bd_size_t ERASE_SIZE = 4096;
+
+  int write(const uint8_t *data, bd_addr_t addr, bd_size_t size) {
+    if (fseek(_file, addr, SEEK_SET) || fwrite(data, 1, size, _file) != size) {
+      return BD_ERROR_DEVICE_ERROR;
+    }
+    return BD_ERROR_OK;
+  }
+
+  const char *_path;
+  bd_size_t _size;
+  FILE *_file;
+  int _inits;
+};
+
+BlockDevice *BlockDevice::get_default_instance() {
+  static SimBlockDevice *bd = nullptr;
+  if (!bd) {
+    const char *path = getenv("TSL2591_SIM_BLOCKDEVICE");
+    const char *kb = getenv("TSL2591_SIM_BLOCKDEVICE_KB");
+    bd_size_t size = (kb ? strtoull(kb, NULL, 0) : 2048) * 1024;
+    size -= size % 4096;
+    bd = new SimBlockDevice((path && *path) ? path : "tsl2591_sim.bd", size);
+  }
+  return bd;
+}
@@ -0,0 +1,52 @@
+/* TSL2591 simulation, the simulated board */
+
+#include "mbed.h"
+#include "SimBoard.h"
+
+#if defined(MBED_CONF_APP_TSL2591_INT_PIN)
+#define SIM_TSL2591_INT_PIN MBED_CONF_APP_TSL2591_INT_PIN
+#elif defined(MBED_CONF_APP_DATA_READY_PIN)
+#define SIM_TSL2591_INT_PIN MBED_CONF_APP_DATA_READY_PIN
+#else
+#define SIM_TSL2591_INT_PIN D2
+#endif
+
+#define SIM_TSL2591_ADDR (0x29)
+
+static const char *env(const char *name, const char *fallback) {
+  const char *value = getenv(name);
+  return (value && *value) ? value : fallback;
+}
+
+namespace sim {
+
+Board::Board() : tsl2591(light, SIM_TSL2591_INT_PIN) {
+  const char *profile = env("TSL2591_SIM_LIGHT", "const:250");
+  if (!light.parse(profile)) {
+    fprintf(stderr, "sim: invalid TSL2591_SIM_LIGHT \"%s\"\n", profile);
+    exit(2);
+  }
+  light.setIrPercent(atof(env("TSL2591_SIM_IR_PERCENT", "25")));
+
+  uint32_t seed = strtoul(env("TSL2591_SIM_SEED", "1"), NULL, 0);
+  tsl2591.setNoise(atoi(env("TSL2591_SIM_NOISE", "0")) != 0, seed);
+
+  SimI2CBus &bus = SimI2CBus::instance();
+  bus.setErrorRate(strtoul(env("TSL2591_SIM_I2C_ERROR_PPM", "0"), NULL, 0), seed);
+  bus.attach(SIM_TSL2591_ADDR, &tsl2591);
+
+  setDuration((uint64_t)(atof(env("TSL2591_SIM_DURATION", "60")) * 1e6));
+  atFinish([this](FILE *out) {
+    SimI2CBus::instance().report(out);
+    tsl2591.report(out);
+  });
+  fprintf(stderr, "sim: TSL2591 at 0x%02x, light %s, IR %s %%\n", SIM_TSL2591_ADDR, profile,
+          env("TSL2591_SIM_IR_PERCENT", "25"));
+}
+
+Board &board(void) {
+  static Board *b = new Board();
+  return *b;
+}
+
+} // namespace sim
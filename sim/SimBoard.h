@@ -0,0 +1,44 @@
+/* TSL2591 simulation, the simulated board */
+
+#ifndef SIM_BOARD_H
+#define SIM_BOARD_H
+
+#include "SimLight.h"
+#include "TSL2591Model.h"
+
+/**************************************************************************/
+/*
+    What is wired up: a TSL2591 at 0x29 on the I2C bus with its INT
+    output on the pin the example expects (tsl2591-int-pin or
+    data-ready-pin from mbed_app.json, D2 otherwise). Set up by the first
+    I2C object, from the environment:
+
+      TSL2591_SIM_DURATION        simulated seconds to run, 0 to run
+                                  until the application ends (60)
+      TSL2591_SIM_LIGHT           light profile, see SimLight.h (const:250)
+      TSL2591_SIM_IR_PERCENT      CH1 share of CH0 (25)
+      TSL2591_SIM_NOISE           1 adds photon noise to the channels (0)
+      TSL2591_SIM_SEED            seed of noise and bus errors (1)
+      TSL2591_SIM_I2C_ERROR_PPM   failed I2C address phases per million (0)
+      TSL2591_SIM_BLOCKDEVICE     file behind BlockDevice::get_default_instance()
+                                  (tsl2591_sim.bd)
+      TSL2591_SIM_BLOCKDEVICE_KB  its size (2048)
+
+    The statistics of the bus and the sensor are part of the summary on
+    stderr at the end of the run.
+*/
+/**************************************************************************/
+namespace sim {
+
+struct Board {
+  Board();
+
+  SimLight light;
+  TSL2591Model tsl2591;
+};
+
+Board &board(void);
+
+} // namespace sim
+
+#endif
@@ -0,0 +1,162 @@
+/* TSL2591 simulation, I2C bus and simulated devices */
+
+#include "mbed.h"
+#include "SimBus.h"
+#include "SimBoard.h"
+
+SimI2CBus &SimI2CBus::instance(void) {
+  static SimI2CBus *bus = new SimI2CBus();
+  return *bus;
+}
+
+SimI2CBus::SimI2CBus() : _active(nullptr), _errorPpm(0), _rng(1) {
+  memset(_devices, 0, sizeof(_devices));
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+void SimI2CBus::attach(uint8_t addr, SimI2CDevice *device) {
+  _devices[addr & 0x7F] = device;
+}
+
+void SimI2CBus::detach(uint8_t addr) {
+  _devices[addr & 0x7F] = nullptr;
+}
+
+void SimI2CBus::setErrorRate(uint32_t ppm, uint32_t seed) {
+  _errorPpm = ppm;
+  _rng = seed ? seed : 1;
+}
+
+bool SimI2CBus::start(uint8_t addr8) {
+  _stats.transfers++;
+  _active = _devices[addr8 >> 1];
+  if (_active && _errorPpm) {
+    // xorshift32
+    _rng ^= _rng << 13;
+    _rng ^= _rng >> 17;
+    _rng ^= _rng << 5;
+    if (_rng % 1000000 < _errorPpm) {
+      _stats.injected++;
+      _active = nullptr;
+    }
+  }
+  if (!_active) {
+    _stats.nacks++;
+    return false;
+  }
+  _active->start(addr8 & 1);
+  return true;
+}
+
+bool SimI2CBus::write(uint8_t data) {
+  if (!_active) {
+    return false;
+  }
+  _stats.bytes++;
+  if (!_active->write(data)) {
+    _stats.nacks++;
+    return false;
+  }
+  return true;
+}
+
+uint8_t SimI2CBus::read(void) {
+  if (!_active) {
+    return 0xFF;
+  }
+  _stats.bytes++;
+  return _active->read();
+}
+
+void SimI2CBus::stop(void) {
+  if (_active) {
+    _active->stop();
+    _active = nullptr;
+  }
+}
+
+void SimI2CBus::report(FILE *out) const {
+  fprintf(out, "sim: i2c %lu transfers, %lu bytes, %lu NACKs (%lu injected)\n",
+          (unsigned long)_stats.transfers, (unsigned long)_stats.bytes,
+          (unsigned long)_stats.nacks, (unsigned long)_stats.injected);
+}
+
+/**************************************************************************/
+/*
+    mbed::I2C
+*/
+/**************************************************************************/
+namespace mbed {
+
+I2C::I2C(PinName sda, PinName scl) : _hz(100000), _addressNext(false), _writing(false) {
+  (void)sda;
+  (void)scl;
+  sim::board();
+}
+
+void I2C::frequency(int hz) {
+  _hz = hz > 0 ? hz : 100000;
+}
+
+/* 9 clocks per byte (ACK), plus one byte time for start and stop */
+void I2C::byteTime(int bytes) {
+  sim::busy(((uint64_t)bytes * 9 * 1000000 + _hz - 1) / _hz);
+}
+
+int I2C::write(int address, const char *data, int length, bool repeated) {
+  SimI2CBus &bus = SimI2CBus::instance();
+  int sent = 0;
+  bool ack = bus.start((uint8_t)(address & ~1));
+  for (; ack && sent < length; sent++) {
+    ack = bus.write((uint8_t)data[sent]);
+  }
+  if (!ack || !repeated) {
+    bus.stop();
+  }
+  byteTime(sent + 2);
+  return ack ? 0 : 1;
+}
+
+int I2C::read(int address, char *data, int length, bool repeated) {
+  SimI2CBus &bus = SimI2CBus::instance();
+  bool ack = bus.start((uint8_t)(address | 1));
+  for (int i = 0; ack && i < length; i++) {
+    data[i] = (char)bus.read();
+  }
+  if (!ack || !repeated) {
+    bus.stop();
+  }
+  byteTime((ack ? length : 0) + 2);
+  return ack ? 0 : 1;
+}
+
+void I2C::start(void) {
+  _addressNext = true;
+}
+
+void I2C::stop(void) {
+  _addressNext = false;
+  SimI2CBus::instance().stop();
+}
+
+int I2C::write(int data) {
+  SimI2CBus &bus = SimI2CBus::instance();
+  bool ack;
+  if (_addressNext) {
+    _addressNext = false;
+    _writing = (data & 1) == 0;
+    ack = bus.start((uint8_t)data);
+  } else {
+    ack = _writing && bus.write((uint8_t)data);
+  }
+  byteTime(1);
+  return ack ? 1 : 0;
+}
+
+int I2C::read(int ack) {
+  (void)ack;
+  byteTime(1);
+  return _writing ? 0xFF : SimI2CBus::instance().read();
+}
+
+} // namespace mbed
@@ -0,0 +1,69 @@
+/* TSL2591 simulation, I2C bus and simulated devices */
+
+#ifndef SIM_BUS_H
+#define SIM_BUS_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/**************************************************************************/
+/*
+    A device on the simulated bus, byte by byte as seen on the wire:
+    start (or repeated start) with the direction, the bytes written by
+    the master (return false to NACK), the bytes it reads, stop.
+*/
+/**************************************************************************/
+class SimI2CDevice {
+public:
+  virtual ~SimI2CDevice() {}
+
+  virtual void start(bool read) = 0;
+  virtual bool write(uint8_t data) = 0;
+  virtual uint8_t read(void) = 0;
+  virtual void stop(void) = 0;
+};
+
+struct SimI2CStats {
+  uint32_t transfers;   // address phases
+  uint32_t bytes;       // data bytes
+  uint32_t nacks;       // address or data NACKed
+  uint32_t injected;    // part of nacks caused by setErrorRate()
+};
+
+/**************************************************************************/
+/*
+    The bus all mbed::I2C objects share. setErrorRate() lets a share of
+    the address phases fail (NACK), to exercise retries and recovery.
+*/
+/**************************************************************************/
+class SimI2CBus {
+public:
+  static SimI2CBus &instance(void);
+
+  /* 7 bit address */
+  void attach(uint8_t addr, SimI2CDevice *device);
+  void detach(uint8_t addr);
+
+  /* Failed address phases per million, deterministic for a seed */
+  void setErrorRate(uint32_t ppm, uint32_t seed = 1);
+
+  /* Master side, addr8 is the address byte with the R/W bit */
+  bool start(uint8_t addr8);
+  bool write(uint8_t data);
+  uint8_t read(void);
+  void stop(void);
+
+  const SimI2CStats &stats(void) const { return _stats; }
+  void report(FILE *out) const;
+
+private:
+  SimI2CBus();
+
+  SimI2CDevice *_devices[128];
+  SimI2CDevice *_active;
+  uint32_t _errorPpm;
+  uint32_t _rng;
+  SimI2CStats _stats;
+};
+
+#endif
@@ -0,0 +1,583 @@
+/* TSL2591 simulation, simulated time, cooperative threads and pins */
+
+#include "mbed.h"
+#include <ucontext.h>
+#include <unistd.h>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+namespace sim {
+
+// Host printf needs more than the stacks sized for the target
+#define SIM_MIN_STACK_SIZE (256 * 1024)
+
+struct Task {
+  enum State { READY, RUNNING, BLOCKED, DONE };
+
+  ucontext_t ctx;
+  char *stack;
+  std::function<void()> entry;
+  int priority;
+  const char *name;
+  State state;
+  uint64_t readySeq;   // FIFO among threads of the same priority
+  WaitList *list;      // the list it is blocked on
+  Task *next;
+  Task *prev;
+  int timer;           // timeout of the current block()
+  bool timedOut;
+  WaitList joiners;
+};
+
+struct Pin {
+  Pin() : driven(-1), pull(1) {}
+  int level(void) const { return driven >= 0 ? driven : pull; }
+
+  int driven;
+  int pull;
+  std::vector<void *> irqs;
+};
+
+struct Kernel {
+  Kernel() : now(0), end(0), idle(0), sleep(0), busy(0), current(&main), nextTimer(1), isr(0),
+             readySeq(0), deepSleepLocks(0), finishing(false), wallStart(std::chrono::steady_clock::now()) {
+    main.stack = nullptr;
+    main.priority = osPriorityNormal;
+    main.name = "main";
+    main.state = Task::RUNNING;
+    main.readySeq = 0;
+    main.list = nullptr;
+    main.next = main.prev = nullptr;
+    main.timer = 0;
+    main.timedOut = false;
+    tasks.push_back(&main);
+  }
+
+  uint64_t now;
+  uint64_t end;
+  uint64_t idle;
+  uint64_t sleep;     // part of idle with deep sleep locked
+  uint64_t busy;
+  Task main;
+  Task *current;
+  std::vector<Task *> tasks;
+  std::map<std::pair<uint64_t, int>, std::function<void()>> timers;
+  std::unordered_map<int, uint64_t> timerAt;
+  int nextTimer;
+  int isr;
+  uint64_t readySeq;
+  int deepSleepLocks;
+  std::map<int, Pin> pins;
+  std::vector<std::function<void(FILE *)>> reports;
+  bool finishing;
+  std::chrono::steady_clock::time_point wallStart;
+};
+
+static void onExit(void);
+
+// Never destroyed, threads may still run while the statics go away
+static Kernel &kernel(void) {
+  static Kernel *k = nullptr;
+  if (!k) {
+    k = new Kernel();
+    atexit(onExit);
+  }
+  return *k;
+}
+
+/**************************************************************************/
+/*
+    Wait lists
+*/
+/**************************************************************************/
+static void append(WaitList &list, Task *t) {
+  t->list = &list;
+  t->next = nullptr;
+  t->prev = list.last;
+  if (list.last) {
+    list.last->next = t;
+  } else {
+    list.first = t;
+  }
+  list.last = t;
+}
+
+static void unlink(Task *t) {
+  WaitList *list = t->list;
+  if (!list) {
+    return;
+  }
+  if (t->prev) {
+    t->prev->next = t->next;
+  } else {
+    list->first = t->next;
+  }
+  if (t->next) {
+    t->next->prev = t->prev;
+  } else {
+    list->last = t->prev;
+  }
+  t->list = nullptr;
+  t->next = t->prev = nullptr;
+}
+
+static void makeReady(Task *t) {
+  Kernel &k = kernel();
+  t->state = Task::READY;
+  t->readySeq = ++k.readySeq;
+}
+
+/**************************************************************************/
+/*
+    Timers and the clock
+*/
+/**************************************************************************/
+static void checkEnd(void) {
+  Kernel &k = kernel();
+  if (k.end && k.now >= k.end) {
+    k.now = k.end;
+    finish(0);
+  }
+}
+
+static void advanceTo(uint64_t t) {
+  Kernel &k = kernel();
+  while (!k.timers.empty() && k.timers.begin()->first.first <= t) {
+    auto it = k.timers.begin();
+    uint64_t at = it->first.first;
+    std::function<void()> fn = std::move(it->second);
+    k.timerAt.erase(it->first.second);
+    k.timers.erase(it);
+    if (at > k.now) {
+      k.now = at;
+    }
+    checkEnd();
+    k.isr++;
+    fn();
+    k.isr--;
+  }
+  if (t > k.now) {
+    k.now = t;
+  }
+  checkEnd();
+}
+
+uint64_t now(void) {
+  return kernel().now;
+}
+
+uint64_t deadline(std::chrono::duration<uint32_t, std::milli> rel) {
+  if (rel.count() == osWaitForever) {
+    return FOREVER;
+  }
+  return kernel().now + (uint64_t)rel.count() * 1000;
+}
+
+int startTimer(uint64_t at, std::function<void()> fn) {
+  Kernel &k = kernel();
+  int id = k.nextTimer++;
+  k.timers.emplace(std::make_pair(at, id), std::move(fn));
+  k.timerAt[id] = at;
+  return id;
+}
+
+void cancelTimer(int id) {
+  Kernel &k = kernel();
+  auto it = k.timerAt.find(id);
+  if (it != k.timerAt.end()) {
+    k.timers.erase(std::make_pair(it->second, id));
+    k.timerAt.erase(it);
+  }
+}
+
+bool inIsr(void) {
+  return kernel().isr > 0;
+}
+
+/**************************************************************************/
+/*
+    Scheduler
+*/
+/**************************************************************************/
+static Task *pickReady(void) {
+  Kernel &k = kernel();
+  Task *best = nullptr;
+  for (Task *t : k.tasks) {
+    if (t->state == Task::READY &&
+        (!best || t->priority > best->priority ||
+         (t->priority == best->priority && t->readySeq < best->readySeq))) {
+      best = t;
+    }
+  }
+  return best;
+}
+
+static void switchTo(Task *next) {
+  Kernel &k = kernel();
+  Task *prev = k.current;
+  next->state = Task::RUNNING;
+  if (next == prev) {
+    return;
+  }
+  k.current = next;
+  swapcontext(&prev->ctx, &next->ctx);
+}
+
+/* The current thread gave up the CPU (blocked, done or ready), runs the
+   next one, letting time pass until there is one */
+static void schedule(void) {
+  Kernel &k = kernel();
+  while (true) {
+    Task *next = pickReady();
+    if (next) {
+      switchTo(next);
+      return;
+    }
+    if (k.timers.empty()) {
+      // Nothing will ever happen again
+      finish(k.main.state == Task::DONE ? 0 : 1);
+    }
+    uint64_t at = k.timers.begin()->first.first;
+    if (at > k.now) {
+      uint64_t idle = (k.end && at > k.end ? k.end : at) - k.now;
+      k.idle += idle;
+      if (k.deepSleepLocks) {
+        k.sleep += idle;
+      }
+    }
+    advanceTo(at);
+  }
+}
+
+/* A higher priority thread woken up by an ISR takes over */
+static void preempt(void) {
+  Kernel &k = kernel();
+  Task *next = pickReady();
+  if (next && next->priority > k.current->priority) {
+    makeReady(k.current);
+    switchTo(next);
+  }
+}
+
+void busy(uint64_t us) {
+  Kernel &k = kernel();
+  if (k.isr) {
+    k.now += us;
+    return;
+  }
+  k.busy += us;
+  advanceTo(k.now + us);
+  preempt();
+}
+
+static void expire(Task *t) {
+  t->timer = 0;
+  unlink(t);
+  t->timedOut = true;
+  makeReady(t);
+}
+
+static void wake(Task *t) {
+  unlink(t);
+  if (t->timer) {
+    cancelTimer(t->timer);
+    t->timer = 0;
+  }
+  makeReady(t);
+}
+
+bool block(WaitList *list, uint64_t deadline) {
+  Kernel &k = kernel();
+  if (k.isr) {
+    fprintf(stderr, "sim: blocking call in ISR context\n");
+    abort();
+  }
+  if (deadline <= k.now) {
+    return false;
+  }
+  Task *t = k.current;
+  t->state = Task::BLOCKED;
+  t->timedOut = false;
+  if (list) {
+    append(*list, t);
+  }
+  t->timer = (deadline != FOREVER) ? startTimer(deadline, [t]() { expire(t); }) : 0;
+  schedule();
+  return !t->timedOut;
+}
+
+void wakeOne(WaitList &list) {
+  if (list.first) {
+    wake(list.first);
+  }
+}
+
+void wakeAll(WaitList &list) {
+  while (list.first) {
+    wake(list.first);
+  }
+}
+
+void yield(void) {
+  Kernel &k = kernel();
+  if (k.isr) {
+    return;
+  }
+  makeReady(k.current);
+  schedule();
+}
+
+/**************************************************************************/
+/*
+    Threads
+*/
+/**************************************************************************/
+static void trampoline(void) {
+  Kernel &k = kernel();
+  Task *t = k.current;
+  t->entry();
+  t->state = Task::DONE;
+  wakeAll(t->joiners);
+  schedule();
+  abort();
+}
+
+Task *createTask(std::function<void()> entry, int priority, uint32_t stackSize, const char *name) {
+  Kernel &k = kernel();
+  size_t size = stackSize < SIM_MIN_STACK_SIZE ? SIM_MIN_STACK_SIZE : stackSize;
+  Task *t = new Task();
+  t->stack = new char[size];
+  t->entry = std::move(entry);
+  t->priority = priority;
+  t->name = name ? name : "thread";
+  t->list = nullptr;
+  t->next = t->prev = nullptr;
+  t->timer = 0;
+  t->timedOut = false;
+  getcontext(&t->ctx);
+  t->ctx.uc_stack.ss_sp = t->stack;
+  t->ctx.uc_stack.ss_size = size;
+  t->ctx.uc_link = nullptr;
+  makecontext(&t->ctx, trampoline, 0);
+  k.tasks.push_back(t);
+  makeReady(t);
+  if (!k.isr) {
+    preempt();
+  }
+  return t;
+}
+
+bool joinTask(Task *t) {
+  if (t == kernel().current) {
+    return false;
+  }
+  while (t->state != Task::DONE) {
+    block(&t->joiners, FOREVER);
+  }
+  return true;
+}
+
+void terminateTask(Task *t) {
+  Kernel &k = kernel();
+  if (t->state == Task::DONE) {
+    return;
+  }
+  unlink(t);
+  if (t->timer) {
+    cancelTimer(t->timer);
+    t->timer = 0;
+  }
+  t->state = Task::DONE;
+  wakeAll(t->joiners);
+  if (t == k.current) {
+    schedule();
+  }
+}
+
+void destroyTask(Task *t) {
+  Kernel &k = kernel();
+  terminateTask(t);
+  for (size_t i = 0; i < k.tasks.size(); i++) {
+    if (k.tasks[i] == t) {
+      k.tasks.erase(k.tasks.begin() + i);
+      break;
+    }
+  }
+  delete[] t->stack;
+  delete t;
+}
+
+void setTaskPriority(Task *t, int priority) {
+  t->priority = priority;
+  if (!kernel().isr) {
+    preempt();
+  }
+}
+
+Task *currentTask(void) {
+  return kernel().current;
+}
+
+const char *taskName(Task *t) {
+  return t->name;
+}
+
+/**************************************************************************/
+/*
+    Pins
+*/
+/**************************************************************************/
+static void pinChanged(Pin &p, int before) {
+  int level = p.level();
+  if (level == before) {
+    return;
+  }
+  Kernel &k = kernel();
+  std::vector<void *> irqs = p.irqs;
+  k.isr++;
+  for (void *irq : irqs) {
+    static_cast<mbed::InterruptIn *>(irq)->edge(level);
+  }
+  k.isr--;
+}
+
+int pinRead(int pin) {
+  return kernel().pins[pin].level();
+}
+
+void pinWrite(int pin, int value) {
+  Pin &p = kernel().pins[pin];
+  int before = p.level();
+  p.driven = value ? 1 : 0;
+  pinChanged(p, before);
+}
+
+void pinRelease(int pin) {
+  Pin &p = kernel().pins[pin];
+  int before = p.level();
+  p.driven = -1;
+  pinChanged(p, before);
+}
+
+void pinMode(int pin, int mode) {
+  Pin &p = kernel().pins[pin];
+  int before = p.level();
+  p.pull = (mode == PullDown) ? 0 : 1;
+  pinChanged(p, before);
+}
+
+void pinAttach(int pin, void *irq) {
+  kernel().pins[pin].irqs.push_back(irq);
+}
+
+void pinDetach(int pin, void *irq) {
+  std::vector<void *> &irqs = kernel().pins[pin].irqs;
+  for (size_t i = 0; i < irqs.size(); i++) {
+    if (irqs[i] == irq) {
+      irqs.erase(irqs.begin() + i);
+      return;
+    }
+  }
+}
+
+/**************************************************************************/
+/*
+    Run control
+*/
+/**************************************************************************/
+void setDuration(uint64_t us) {
+  kernel().end = us;
+}
+
+void atFinish(std::function<void(FILE *out)> report) {
+  kernel().reports.push_back(std::move(report));
+}
+
+uint64_t idleTime(void) {
+  return kernel().idle;
+}
+
+uint64_t busyTime(void) {
+  return kernel().busy;
+}
+
+void finish(int status) {
+  Kernel &k = kernel();
+  if (k.finishing) {
+    return;
+  }
+  k.finishing = true;
+  fflush(stdout);
+
+  static const char *reasons[] = { "done", "all threads blocked" };
+  double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - k.wallStart).count();
+  double simulated = k.now / 1e6;
+  fprintf(stderr, "sim: %.3f s simulated in %.3f s (%.0fx real time), %s\n", simulated, wall,
+          wall > 0 ? simulated / wall : 0.0, (k.end && k.now >= k.end) ? "duration reached" : reasons[status ? 1 : 0]);
+  fprintf(stderr, "sim: cpu idle %.1f %% (deep sleep %.1f %%), busy waits %.1f %%\n",
+          k.now ? 100.0 * k.idle / k.now : 0.0, k.now ? 100.0 * (k.idle - k.sleep) / k.now : 0.0,
+          k.now ? 100.0 * k.busy / k.now : 0.0);
+  for (auto &report : k.reports) {
+    report(stderr);
+  }
+  fflush(NULL);
+  _exit(status);
+}
+
+/* main() returned: the threads keep running, like on the target */
+static void onExit(void) {
+  Kernel &k = kernel();
+  if (k.finishing || k.current != &k.main) {
+    finish(0);
+    return;
+  }
+  k.main.state = Task::DONE;
+  wakeAll(k.main.joiners);
+  schedule();
+}
+
+} // namespace sim
+
+/**************************************************************************/
+/*
+    Platform functions
+*/
+/**************************************************************************/
+uint32_t SystemCoreClock = 216000000;
+
+uint32_t us_ticker_read(void) {
+  return (uint32_t)sim::now();
+}
+
+void wait_us(int us) {
+  if (us > 0) {
+    sim::busy((uint64_t)us);
+  }
+}
+
+void thread_sleep_for(uint32_t millisec) {
+  sim::block(nullptr, sim::deadline(std::chrono::duration<uint32_t, std::milli>(millisec)));
+}
+
+void sleep_manager_lock_deep_sleep(void) {
+  sim::kernel().deepSleepLocks++;
+}
+
+void sleep_manager_unlock_deep_sleep(void) {
+  if (sim::kernel().deepSleepLocks > 0) {
+    sim::kernel().deepSleepLocks--;
+  }
+}
+
+bool sleep_manager_can_deep_sleep(void) {
+  return sim::kernel().deepSleepLocks == 0;
+}
+
+void mbed_stats_cpu_get(mbed_stats_cpu_t *stats) {
+  sim::Kernel &k = sim::kernel();
+  stats->uptime = k.now;
+  stats->idle_time = k.idle;
+  stats->sleep_time = k.sleep;
+  stats->deep_sleep_time = k.idle - k.sleep;
+}
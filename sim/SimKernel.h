@@ -0,0 +1,90 @@
+/* TSL2591 simulation, simulated time, cooperative threads and pins */
+
+#ifndef SIM_KERNEL_H
+#define SIM_KERNEL_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <chrono>
+#include <functional>
+
+/**************************************************************************/
+/*
+    Everything below the host mbed.h. Time is in us since the start of
+    the run and moves only when nobody can run (all threads blocked) or
+    in busy waits. Timer callbacks run in ISR context: they may wake up
+    threads but never block.
+
+    A run ends when the simulated time reaches the limit set with
+    setDuration() (TSL2591_SIM_DURATION, see SimBoard.h), when main()
+    and all threads returned, or when every thread waits for something
+    that can't happen any more (exit status 1). The summary goes to
+    stderr, stdout only carries what the application printed.
+*/
+/**************************************************************************/
+namespace sim {
+
+static const uint64_t FOREVER = UINT64_MAX;
+
+struct Task;
+
+/* Threads blocked on one object, in the order they blocked */
+struct WaitList {
+  WaitList() : first(nullptr), last(nullptr) {}
+  Task *first;
+  Task *last;
+};
+
+/* Simulated time in us */
+uint64_t now(void);
+
+/* Absolute deadlines, a duration of osWaitForever never expires */
+uint64_t deadline(std::chrono::duration<uint32_t, std::milli> rel);
+template <typename Clock, typename Duration>
+uint64_t deadline(std::chrono::time_point<Clock, Duration> abs) {
+  auto us = std::chrono::duration_cast<std::chrono::microseconds>(abs.time_since_epoch()).count();
+  return us < 0 ? 0 : (uint64_t)us;
+}
+
+/* Lets time pass for a running thread (wait_us, bus transfers) */
+void busy(uint64_t us);
+
+/* Blocks the current thread on list (may be null: sleep) until woken
+   up or until deadline, false on timeout */
+bool block(WaitList *list, uint64_t deadline);
+void wakeOne(WaitList &list);
+void wakeAll(WaitList &list);
+void yield(void);
+
+/* Cooperative threads */
+Task *createTask(std::function<void()> entry, int priority, uint32_t stackSize, const char *name);
+void destroyTask(Task *task);
+bool joinTask(Task *task);
+void terminateTask(Task *task);
+void setTaskPriority(Task *task, int priority);
+Task *currentTask(void);
+const char *taskName(Task *task);
+
+/* ISR context timers, returns an id for cancelTimer() */
+int startTimer(uint64_t at, std::function<void()> fn);
+void cancelTimer(int id);
+bool inIsr(void);
+
+/* Pins: level is the driven value, otherwise the pull (released high) */
+int pinRead(int pin);
+void pinWrite(int pin, int value);
+void pinRelease(int pin);
+void pinMode(int pin, int mode);
+void pinAttach(int pin, void *irq);
+void pinDetach(int pin, void *irq);
+
+/* Run control and statistics */
+void setDuration(uint64_t us);
+void atFinish(std::function<void(FILE *out)> report);
+void finish(int status);
+uint64_t idleTime(void);
+uint64_t busyTime(void);
+
+} // namespace sim
+
+#endif
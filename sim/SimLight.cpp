@@ -0,0 +1,130 @@
+/* TSL2591 simulation, light profiles */
+
+#include "SimLight.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+SimLight::SimLight() : _kind(CONST), _a(250.0F), _b(0.0F), _periodMs(1000.0F), _irPercent(25.0F) {
+}
+
+bool SimLight::parse(const char *spec) {
+  float a, b, period;
+  char end;
+
+  if (sscanf(spec, "const:%f%c", &a, &end) == 1) {
+    _kind = CONST;
+    _a = a;
+    return true;
+  }
+  if (strncmp(spec, "file:", 5) == 0) {
+    if (!load(spec + 5)) {
+      return false;
+    }
+    _kind = FILE_;
+    return true;
+  }
+
+  static const struct {
+    const char *format;
+    Kind kind;
+  } periodic[] = {
+    { "step:%f:%f:%f%c", STEP },
+    { "ramp:%f:%f:%f%c", RAMP },
+    { "sine:%f:%f:%f%c", SINE },
+  };
+  for (size_t i = 0; i < sizeof(periodic) / sizeof(periodic[0]); i++) {
+    if (sscanf(spec, periodic[i].format, &a, &b, &period, &end) == 3 && period > 0) {
+      _kind = periodic[i].kind;
+      _a = a;
+      _b = b;
+      _periodMs = period;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool SimLight::load(const char *path) {
+  FILE *f = fopen(path, "r");
+  if (!f) {
+    return false;
+  }
+  std::vector<Point> points;
+  char line[128];
+  while (fgets(line, sizeof(line), f)) {
+    Point p;
+    p.irPercent = -1.0F;
+    if (line[0] == '#' || sscanf(line, "%f,%f,%f", &p.ms, &p.lux, &p.irPercent) < 2) {
+      continue;
+    }
+    // Time must not go backwards
+    if (!points.empty() && p.ms < points.back().ms) {
+      points.clear();
+      break;
+    }
+    points.push_back(p);
+  }
+  fclose(f);
+  if (points.empty()) {
+    return false;
+  }
+  _points.swap(points);
+  return true;
+}
+
+/* Index of the last point at or before ms */
+size_t SimLight::segment(float ms) const {
+  size_t lo = 0, hi = _points.size();
+  while (hi - lo > 1) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (_points[mid].ms <= ms) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+float SimLight::lux(uint64_t t) const {
+  float ms = t / 1000.0F;
+  float phase = fmodf(ms, _periodMs) / _periodMs;
+  float lux = _a;
+
+  switch (_kind) {
+    case CONST:
+      break;
+    case STEP:
+      lux = (phase < 0.5F) ? _a : _b;
+      break;
+    case RAMP:
+      lux = _a + (_b - _a) * (phase < 0.5F ? 2.0F * phase : 2.0F - 2.0F * phase);
+      break;
+    case SINE:
+      lux = _a + _b * sinf(2.0F * (float)M_PI * phase);
+      break;
+    case FILE_: {
+      size_t i = segment(ms);
+      const Point &p = _points[i];
+      lux = p.lux;
+      if (i + 1 < _points.size() && ms > p.ms) {
+        const Point &q = _points[i + 1];
+        lux += (q.lux - p.lux) * (ms - p.ms) / (q.ms - p.ms);
+      }
+      break;
+    }
+  }
+  return lux > 0.0F ? lux : 0.0F;
+}
+
+float SimLight::irPercent(uint64_t t) const {
+  if (_kind == FILE_) {
+    const Point &p = _points[segment(t / 1000.0F)];
+    if (p.irPercent >= 0.0F) {
+      return p.irPercent;
+    }
+  }
+  return _irPercent;
+}
@@ -0,0 +1,57 @@
+/* TSL2591 simulation, light profiles */
+
+#ifndef SIM_LIGHT_H
+#define SIM_LIGHT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/**************************************************************************/
+/*
+    Illuminance over simulated time, from a profile string:
+
+      const:LUX                    constant
+      step:LO:HI:PERIOD_MS         square wave, LO for the first half
+      ramp:LO:HI:PERIOD_MS         triangle LO -> HI -> LO
+      sine:MEAN:AMPLITUDE:PERIOD_MS
+      file:PATH                    CSV lines "ms,lux[,ir_percent]",
+                                   interpolated, held after the last one
+
+    The IR share (CH1 / CH0) is irPercent unless the file has its own
+    column. Values are clipped at 0 lux.
+*/
+/**************************************************************************/
+class SimLight {
+public:
+  SimLight();
+
+  /* False (and the profile unchanged) if spec is not valid */
+  bool parse(const char *spec);
+  void setIrPercent(float percent) { _irPercent = percent; }
+
+  /* At t us */
+  float lux(uint64_t t) const;
+  float irPercent(uint64_t t) const;
+
+private:
+  enum Kind { CONST, STEP, RAMP, SINE, FILE_ };
+
+  struct Point {
+    float ms;
+    float lux;
+    float irPercent;   // < 0: not given
+  };
+
+  bool load(const char *path);
+  size_t segment(float ms) const;
+
+  Kind _kind;
+  float _a;
+  float _b;
+  float _periodMs;
+  float _irPercent;
+  std::vector<Point> _points;
+};
+
+#endif
@@ -0,0 +1,357 @@
+/* TSL2591 simulation, drivers, events and RTOS objects of the host mbed.h */
+
+#include "mbed.h"
+
+namespace mbed {
+
+/**************************************************************************/
+/*
+    InterruptIn
+*/
+/**************************************************************************/
+InterruptIn::InterruptIn(PinName pin) : InterruptIn(pin, PullDefault) {
+}
+
+InterruptIn::InterruptIn(PinName pin, PinMode mode) : _pin(pin), _enabled(true) {
+  sim::pinMode(pin, mode);
+  sim::pinAttach(pin, this);
+}
+
+InterruptIn::~InterruptIn() {
+  sim::pinDetach(_pin, this);
+}
+
+void InterruptIn::edge(int level) {
+  if (!_enabled) {
+    return;
+  }
+  if (level == 0 && _fall) {
+    _fall();
+  } else if (level != 0 && _rise) {
+    _rise();
+  }
+}
+
+/**************************************************************************/
+/*
+    Timeout and Ticker
+*/
+/**************************************************************************/
+void Timeout::attach(Callback<void()> func, std::chrono::microseconds t) {
+  detach();
+  _func = func;
+  _period = t;
+  arm(sim::now() + t.count());
+}
+
+void Timeout::detach(void) {
+  if (_id) {
+    sim::cancelTimer(_id);
+    _id = 0;
+  }
+}
+
+void Timeout::arm(uint64_t at) {
+  _id = sim::startTimer(at, [this]() {
+    _id = 0;
+    handler();
+  });
+}
+
+void Timeout::handler(void) {
+  if (_func) {
+    _func();
+  }
+}
+
+void Ticker::handler(void) {
+  arm(sim::now() + _period.count());
+  Timeout::handler();
+}
+
+ssize_t BufferedSerial::write(const void *buffer, size_t length) {
+  return (ssize_t)fwrite(buffer, 1, length, stdout);
+}
+
+} // namespace mbed
+
+namespace events {
+
+struct EventQueue::Event {
+  int id;
+  uint64_t due;
+  int64_t period;    // < 0: once
+  std::function<void()> fn;
+  Event *next;
+};
+
+EventQueue::EventQueue(unsigned size, unsigned char *buffer)
+  : _events(nullptr), _capacity(size / EVENTS_EVENT_SIZE), _count(0), _nextId(1), _running(0),
+    _cancelRunning(false), _break(false) {
+  (void)buffer;
+  if (_capacity == 0) {
+    _capacity = 1;
+  }
+}
+
+EventQueue::~EventQueue() {
+  while (_events) {
+    Event *e = _events;
+    _events = e->next;
+    delete e;
+  }
+}
+
+/* Behind the events due at the same time, they run in posting order */
+void EventQueue::insert(Event *e) {
+  Event **p = &_events;
+  while (*p && (*p)->due <= e->due) {
+    p = &(*p)->next;
+  }
+  e->next = *p;
+  *p = e;
+}
+
+int EventQueue::post(int64_t delay, int64_t period, std::function<void()> fn) {
+  if (_count >= _capacity) {
+    return 0;
+  }
+  Event *e = new Event;
+  e->id = _nextId;
+  _nextId = (_nextId == INT32_MAX) ? 1 : _nextId + 1;
+  e->due = sim::now() + (delay > 0 ? delay : 0);
+  e->period = period;
+  e->fn = std::move(fn);
+  insert(e);
+  _count++;
+  sim::wakeAll(_dispatcher);
+  return e->id;
+}
+
+void EventQueue::dispatch(int ms) {
+  uint64_t until = (ms < 0) ? sim::FOREVER : sim::now() + (uint64_t)ms * 1000;
+  while (true) {
+    while (_events && _events->due <= sim::now() && !_break) {
+      Event *e = _events;
+      _events = e->next;
+      _running = e->id;
+      _cancelRunning = false;
+      e->fn();
+      _running = 0;
+      if (e->period >= 0 && !_cancelRunning) {
+        e->due += (e->period > 0) ? e->period : 1;
+        insert(e);
+      } else {
+        delete e;
+        _count--;
+      }
+    }
+    if (_break) {
+      _break = false;
+      return;
+    }
+    if (sim::now() >= until) {
+      return;
+    }
+    uint64_t wake = (_events && _events->due < until) ? _events->due : until;
+    sim::block(&_dispatcher, wake);
+  }
+}
+
+void EventQueue::break_dispatch(void) {
+  _break = true;
+  sim::wakeAll(_dispatcher);
+}
+
+bool EventQueue::cancel(int id) {
+  if (id == 0) {
+    return false;
+  }
+  if (id == _running) {
+    _cancelRunning = true;
+    return true;
+  }
+  for (Event **p = &_events; *p; p = &(*p)->next) {
+    if ((*p)->id == id) {
+      Event *e = *p;
+      *p = e->next;
+      delete e;
+      _count--;
+      return true;
+    }
+  }
+  return false;
+}
+
+int EventQueue::time_left(int id) {
+  for (Event *e = _events; e; e = e->next) {
+    if (e->id == id) {
+      return e->due > sim::now() ? (int)((e->due - sim::now()) / 1000) : 0;
+    }
+  }
+  return -1;
+}
+
+} // namespace events
+
+namespace rtos {
+
+/**************************************************************************/
+/*
+    Thread
+*/
+/**************************************************************************/
+Thread::Thread(osPriority priority, uint32_t stack_size, unsigned char *stack_mem, const char *name)
+  : _priority(priority), _stackSize(stack_size), _name(name), _task(nullptr) {
+  (void)stack_mem;
+}
+
+Thread::~Thread() {
+  if (_task) {
+    sim::destroyTask(_task);
+  }
+}
+
+osStatus Thread::start(mbed::Callback<void()> task) {
+  if (_task) {
+    return osErrorParameter;
+  }
+  _task = sim::createTask([task]() { task(); }, _priority, _stackSize, _name);
+  return osOK;
+}
+
+osStatus Thread::join(void) {
+  if (_task && !sim::joinTask(_task)) {
+    return osError;
+  }
+  return osOK;
+}
+
+osStatus Thread::terminate(void) {
+  if (_task) {
+    sim::terminateTask(_task);
+  }
+  return osOK;
+}
+
+osStatus Thread::set_priority(osPriority priority) {
+  _priority = priority;
+  if (_task) {
+    sim::setTaskPriority(_task, priority);
+  }
+  return osOK;
+}
+
+osPriority Thread::get_priority(void) const {
+  return _priority;
+}
+
+/**************************************************************************/
+/*
+    Mutex (recursive, like the RTX one)
+*/
+/**************************************************************************/
+bool Mutex::take(uint64_t deadline) {
+  sim::Task *self = sim::currentTask();
+  while (_owner && _owner != self) {
+    if (!sim::block(&_waiters, deadline)) {
+      return false;
+    }
+  }
+  _owner = self;
+  _count++;
+  return true;
+}
+
+void Mutex::lock(void) {
+  take(sim::FOREVER);
+}
+
+bool Mutex::trylock(void) {
+  return take(sim::now());
+}
+
+bool Mutex::trylock_for(Kernel::Clock::duration_u32 rel_time) {
+  return take(sim::deadline(rel_time));
+}
+
+void Mutex::unlock(void) {
+  if (_count && --_count == 0) {
+    _owner = nullptr;
+    sim::wakeOne(_waiters);
+  }
+}
+
+/**************************************************************************/
+/*
+    Semaphore and EventFlags
+*/
+/**************************************************************************/
+bool Semaphore::take(uint64_t deadline) {
+  while (_count == 0) {
+    if (!sim::block(&_waiters, deadline)) {
+      return false;
+    }
+  }
+  _count--;
+  return true;
+}
+
+osStatus Semaphore::release(void) {
+  if (_count >= _max) {
+    return osErrorResource;
+  }
+  _count++;
+  sim::wakeOne(_waiters);
+  return osOK;
+}
+
+uint32_t EventFlags::set(uint32_t flags) {
+  _flags |= flags;
+  sim::wakeAll(_waiters);
+  return _flags;
+}
+
+uint32_t EventFlags::clear(uint32_t flags) {
+  uint32_t before = _flags;
+  _flags &= ~flags;
+  return before;
+}
+
+uint32_t EventFlags::wait(uint32_t flags, uint64_t deadline, bool clear, bool all) {
+  while (true) {
+    uint32_t match = _flags & flags;
+    if (all ? (match == flags) : (match != 0)) {
+      uint32_t result = _flags;
+      if (clear) {
+        _flags &= ~flags;
+      }
+      return result;
+    }
+    if (!sim::block(&_waiters, deadline)) {
+      return osFlagsErrorTimeout;
+    }
+  }
+}
+
+namespace ThisThread {
+
+void sleep_for(Kernel::Clock::duration_u32 rel_time) {
+  sim::block(nullptr, sim::deadline(rel_time));
+}
+
+void sleep_until(Kernel::Clock::time_point abs_time) {
+  sim::block(nullptr, sim::deadline(abs_time));
+}
+
+void yield(void) {
+  sim::yield();
+}
+
+const char *get_name(void) {
+  return sim::taskName(sim::currentTask());
+}
+
+} // namespace ThisThread
+
+} // namespace rtos
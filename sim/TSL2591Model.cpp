@@ -0,0 +1,343 @@
+/* TSL2591 simulation, model of the sensor */
+
+#include "mbed.h"
+#include "TSL2591Model.h"
+
+// Command byte
+#define CMD_BIT          (0x80)
+#define CMD_TRANSACTION  (0x60)
+#define CMD_NORMAL       (0x20)
+#define CMD_SPECIAL      (0x60)
+#define CMD_ADDR         (0x1F)
+
+// Special functions
+#define SF_FORCE_INT     (0x04)
+#define SF_CLEAR_ALS     (0x06)
+#define SF_CLEAR_ALL     (0x07)
+#define SF_CLEAR_NP      (0x0A)
+
+// Registers
+#define REG_ENABLE       (0x00)
+#define REG_CONTROL      (0x01)
+#define REG_AILTL        (0x04)
+#define REG_NPAILTL      (0x08)
+#define REG_PERSIST      (0x0C)
+#define REG_PID          (0x11)
+#define REG_ID           (0x12)
+#define REG_STATUS       (0x13)
+#define REG_C0DATAL      (0x14)
+#define REG_C0DATAH      (0x15)
+#define REG_C1DATAL      (0x16)
+#define REG_C1DATAH      (0x17)
+
+#define ENABLE_PON       (0x01)
+#define ENABLE_AEN       (0x02)
+#define ENABLE_AIEN      (0x10)
+#define ENABLE_SAI       (0x40)
+#define ENABLE_NPIEN     (0x80)
+#define ENABLE_MASK      (ENABLE_PON | ENABLE_AEN | ENABLE_AIEN | ENABLE_SAI | ENABLE_NPIEN)
+
+#define CONTROL_SRESET   (0x80)
+#define CONTROL_AGAIN    (0x30)
+#define CONTROL_ATIME    (0x07)
+
+#define STATUS_AVALID    (0x01)
+#define STATUS_AINT      (0x10)
+#define STATUS_NPINTR    (0x20)
+
+#define CHIP_ID          (0x50)
+
+// Same constants as the driver, so its lux matches the profile
+#define LUX_DF           (408.0F)
+#define MAX_COUNT_100MS  (36863)
+#define MAX_COUNT        (65535)
+
+static const float gains[] = { 1.0F, 25.0F, 428.0F, 9876.0F };
+
+// Consecutive out of window cycles for PERSIST 1..15, 0 is every cycle
+static const uint8_t persistCycles[] = { 0, 1, 2, 3, 5, 10, 15, 20, 25, 30, 35, 40, 45, 50, 55, 60 };
+
+TSL2591Model::TSL2591Model(SimLight &light, int intPin)
+  : _light(light), _intPin(intPin), _addr(0), _commandNext(false), _asserted(false), _timer(0),
+    _noise(false), _rng(1) {
+  memset(&_stats, 0, sizeof(_stats));
+  reset();
+  _stats.resets = 0;
+}
+
+TSL2591Model::~TSL2591Model() {
+  stopCycle();
+}
+
+void TSL2591Model::setNoise(bool enabled, uint32_t seed) {
+  _noise = enabled;
+  _rng = seed ? seed : 1;
+}
+
+void TSL2591Model::reset(void) {
+  stopCycle();
+  memset(_regs, 0, sizeof(_regs));
+  _ch0 = _ch1 = 0;
+  _c0High = _c1High = 0;
+  _persistCount = 0;
+  _stats.resets++;
+  updatePin();
+}
+
+/**************************************************************************/
+/*
+    Bus side
+*/
+/**************************************************************************/
+void TSL2591Model::start(bool read) {
+  _commandNext = !read;
+}
+
+bool TSL2591Model::write(uint8_t data) {
+  if (!_commandNext) {
+    writeRegister(_addr, data);
+    _addr = (_addr + 1) & CMD_ADDR;
+    return true;
+  }
+  _commandNext = false;
+  if (!(data & CMD_BIT)) {
+    return false;
+  }
+  switch (data & CMD_TRANSACTION) {
+    case CMD_NORMAL:
+      _addr = data & CMD_ADDR;
+      return true;
+    case CMD_SPECIAL:
+      specialFunction(data & CMD_ADDR);
+      return true;
+    default:
+      return false;
+  }
+}
+
+uint8_t TSL2591Model::read(void) {
+  uint8_t value = readRegister(_addr);
+  _addr = (_addr + 1) & CMD_ADDR;
+  return value;
+}
+
+void TSL2591Model::stop(void) {
+  _commandNext = false;
+}
+
+/**************************************************************************/
+/*
+    Register file
+*/
+/**************************************************************************/
+bool TSL2591Model::running(void) const {
+  return (_regs[REG_ENABLE] & (ENABLE_PON | ENABLE_AEN)) == (ENABLE_PON | ENABLE_AEN);
+}
+
+void TSL2591Model::writeRegister(uint8_t reg, uint8_t value) {
+  switch (reg) {
+    case REG_ENABLE: {
+      bool was = running();
+      _regs[REG_ENABLE] = value & ENABLE_MASK;
+      if (!was && running()) {
+        // AVALID means a complete cycle since AEN was set
+        _regs[REG_STATUS] &= ~STATUS_AVALID;
+        _persistCount = 0;
+        startCycle();
+      } else if (was && !running()) {
+        stopCycle();
+      }
+      updatePin();
+      break;
+    }
+    case REG_CONTROL:
+      if (value & CONTROL_SRESET) {
+        reset();
+        break;
+      }
+      _regs[REG_CONTROL] = value & (CONTROL_AGAIN | CONTROL_ATIME);
+      if (running()) {
+        startCycle();
+      }
+      break;
+    case REG_PERSIST:
+      _regs[REG_PERSIST] = value & 0x0F;
+      break;
+    default:
+      if (reg >= REG_AILTL && reg < REG_PERSIST) {
+        _regs[reg] = value;
+      }
+      // PID, ID, STATUS and the channels are read only
+      break;
+  }
+}
+
+uint8_t TSL2591Model::readRegister(uint8_t reg) {
+  switch (reg) {
+    case REG_PID:
+      return 0x00;
+    case REG_ID:
+      return CHIP_ID;
+    case REG_C0DATAL:
+      _c0High = _ch0 >> 8;
+      return _ch0 & 0xFF;
+    case REG_C0DATAH:
+      return _c0High;
+    case REG_C1DATAL:
+      _c1High = _ch1 >> 8;
+      return _ch1 & 0xFF;
+    case REG_C1DATAH:
+      return _c1High;
+    default:
+      return _regs[reg];
+  }
+}
+
+void TSL2591Model::specialFunction(uint8_t sf) {
+  switch (sf) {
+    case SF_FORCE_INT:
+      _regs[REG_STATUS] |= STATUS_AINT;
+      break;
+    case SF_CLEAR_ALS:
+      _regs[REG_STATUS] &= ~STATUS_AINT;
+      break;
+    case SF_CLEAR_ALL:
+      _regs[REG_STATUS] &= ~(STATUS_AINT | STATUS_NPINTR);
+      break;
+    case SF_CLEAR_NP:
+      _regs[REG_STATUS] &= ~STATUS_NPINTR;
+      break;
+    default:
+      return;
+  }
+  updatePin();
+  // Sleep after interrupt: the ADCs resume once it is cleared
+  if (running() && !_timer && !_asserted) {
+    startCycle();
+  }
+}
+
+/**************************************************************************/
+/*
+    ADC cycles
+*/
+/**************************************************************************/
+static uint64_t cycleTime(uint8_t control) {
+  return 100000ULL * ((control & CONTROL_ATIME) + 1);
+}
+
+void TSL2591Model::startCycle(void) {
+  stopCycle();
+  _cycleStart = sim::now();
+  _timer = sim::startTimer(_cycleStart + cycleTime(_regs[REG_CONTROL]), [this]() {
+    _timer = 0;
+    endCycle();
+  });
+}
+
+void TSL2591Model::stopCycle(void) {
+  if (_timer) {
+    sim::cancelTimer(_timer);
+    _timer = 0;
+  }
+}
+
+void TSL2591Model::endCycle(void) {
+  uint8_t control = _regs[REG_CONTROL];
+  uint64_t end = _cycleStart + cycleTime(control);
+
+  // Integrate the profile in 1 ms steps, counts at 1x per ms from the lux formula
+  float c0 = 0.0F, c1 = 0.0F;
+  for (uint64_t t = _cycleStart + 500; t < end; t += 1000) {
+    float r = _light.irPercent(t) / 100.0F;
+    r = (r < 0.0F) ? 0.0F : (r > 0.95F ? 0.95F : r);
+    float full = _light.lux(t) / (LUX_DF * (1.0F - r) * (1.0F - r));
+    c0 += full;
+    c1 += full * r;
+  }
+  float gain = gains[(control & CONTROL_AGAIN) >> 4];
+  uint16_t max = (control & CONTROL_ATIME) ? MAX_COUNT : MAX_COUNT_100MS;
+  _ch0 = counts(c0 * gain, max);
+  _ch1 = counts(c1 * gain, max);
+  _stats.conversions++;
+  if (_ch0 >= max || _ch1 >= max) {
+    _stats.saturated++;
+  }
+
+  uint8_t &status = _regs[REG_STATUS];
+  status |= STATUS_AVALID;
+
+  uint16_t lower = _regs[REG_AILTL] | (_regs[REG_AILTL + 1] << 8);
+  uint16_t upper = _regs[REG_AILTL + 2] | (_regs[REG_AILTL + 3] << 8);
+  uint8_t persist = _regs[REG_PERSIST];
+  if (_ch0 < lower || _ch0 > upper) {
+    if (_persistCount < 0xFF) {
+      _persistCount++;
+    }
+  } else {
+    _persistCount = 0;
+  }
+  if (persist == 0 || (_persistCount >= persistCycles[persist])) {
+    status |= STATUS_AINT;
+  }
+
+  lower = _regs[REG_NPAILTL] | (_regs[REG_NPAILTL + 1] << 8);
+  upper = _regs[REG_NPAILTL + 2] | (_regs[REG_NPAILTL + 3] << 8);
+  if (_ch0 < lower || _ch0 > upper) {
+    status |= STATUS_NPINTR;
+  }
+
+  updatePin();
+  _cycleStart = end;
+  if (!(_asserted && (_regs[REG_ENABLE] & ENABLE_SAI))) {
+    _timer = sim::startTimer(end + cycleTime(control), [this]() {
+      _timer = 0;
+      endCycle();
+    });
+  }
+}
+
+uint16_t TSL2591Model::counts(float value, uint16_t max) {
+  if (_noise && value > 0.0F) {
+    value += gauss() * sqrtf(value);
+  }
+  if (value <= 0.0F) {
+    return 0;
+  }
+  return value >= max ? max : (uint16_t)(value + 0.5F);
+}
+
+/* Box-Muller on xorshift32 */
+float TSL2591Model::gauss(void) {
+  float u[2];
+  for (int i = 0; i < 2; i++) {
+    _rng ^= _rng << 13;
+    _rng ^= _rng >> 17;
+    _rng ^= _rng << 5;
+    u[i] = ((_rng >> 8) + 1.0F) / 16777217.0F;
+  }
+  return sqrtf(-2.0F * logf(u[0])) * cosf(2.0F * (float)M_PI * u[1]);
+}
+
+void TSL2591Model::updatePin(void) {
+  uint8_t enable = _regs[REG_ENABLE];
+  uint8_t status = _regs[REG_STATUS];
+  bool assert = ((enable & ENABLE_AIEN) && (status & STATUS_AINT)) ||
+                ((enable & ENABLE_NPIEN) && (status & STATUS_NPINTR));
+  if (assert == _asserted) {
+    return;
+  }
+  _asserted = assert;
+  if (assert) {
+    _stats.interrupts++;
+    sim::pinWrite(_intPin, 0);
+  } else {
+    sim::pinRelease(_intPin);
+  }
+}
+
+void TSL2591Model::report(FILE *out) const {
+  fprintf(out, "sim: tsl2591 %lu conversions (%lu saturated), %lu INT assertions, %lu resets\n",
+          (unsigned long)_stats.conversions, (unsigned long)_stats.saturated,
+          (unsigned long)_stats.interrupts, (unsigned long)_stats.resets);
+}
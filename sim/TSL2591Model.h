@@ -0,0 +1,85 @@
+/* TSL2591 simulation, model of the sensor */
+
+#ifndef SIM_TSL2591_MODEL_H
+#define SIM_TSL2591_MODEL_H
+
+#include "SimBus.h"
+#include "SimLight.h"
+
+struct TSL2591ModelStats {
+  uint32_t conversions;
+  uint32_t saturated;    // CH0 or CH1 clipped
+  uint32_t interrupts;   // INT pin assertions
+  uint32_t resets;       // SRESET
+};
+
+/**************************************************************************/
+/*
+    The TSL2591 as the datasheet describes it, on the simulated time
+    base:
+
+      - command byte (CMD bit, normal transaction with register address
+        and auto increment, special functions 0x04/0x06/0x07/0x0A)
+      - ENABLE, CONTROL (gain, ATIME, SRESET), both threshold windows,
+        PERSIST, PID/ID, STATUS, C0DATA/C1DATA with the high byte
+        latched when the low byte is read
+      - while PON and AEN are set the ADCs run back to back cycles of
+        100 ms * (ATIME + 1); changing CONTROL restarts the cycle. At the
+        end of a cycle the channels are updated, AVALID is set and the
+        persisted (AINT) and no-persist (NPINTR) interrupts are
+        evaluated against CH0. INT is open drain, driven low while an
+        enabled interrupt is pending; SAI stops the ADCs until cleared.
+
+    CH0/CH1 are derived from the light profile with the lux formula and
+    the gain factors the driver uses, so the driver computes the lux of
+    the profile back (until it saturates). Optional noise is Gaussian
+    with the standard deviation of photon noise (sqrt of the counts).
+*/
+/**************************************************************************/
+class TSL2591Model : public SimI2CDevice {
+public:
+  TSL2591Model(SimLight &light, int intPin);
+  ~TSL2591Model();
+
+  void setNoise(bool enabled, uint32_t seed = 1);
+
+  void start(bool read) override;
+  bool write(uint8_t data) override;
+  uint8_t read(void) override;
+  void stop(void) override;
+
+  const TSL2591ModelStats &stats(void) const { return _stats; }
+  void report(FILE *out) const;
+
+private:
+  bool running(void) const;
+  void reset(void);
+  void writeRegister(uint8_t reg, uint8_t value);
+  uint8_t readRegister(uint8_t reg);
+  void specialFunction(uint8_t sf);
+  void startCycle(void);
+  void stopCycle(void);
+  void endCycle(void);
+  void updatePin(void);
+  uint16_t counts(float value, uint16_t max);
+  float gauss(void);
+
+  SimLight &_light;
+  int _intPin;
+  uint8_t _regs[0x20];
+  uint8_t _addr;
+  bool _commandNext;
+  uint16_t _ch0;
+  uint16_t _ch1;
+  uint8_t _c0High;
+  uint8_t _c1High;
+  uint8_t _persistCount;
+  bool _asserted;
+  uint64_t _cycleStart;
+  int _timer;
+  bool _noise;
+  uint32_t _rng;
+  TSL2591ModelStats _stats;
+};
+
+#endif
@@ -0,0 +1,63 @@
+#!/bin/sh
+# TSL2591 simulation, host build of an example against the simulated sensor
+#
+#   sim/build.sh <example> [option=value ...]
+#
+#   sim/build.sh tsl2591
+#   sim/build.sh tsl2591 auto-range=true stats-window=true
+#   sim/build.sh tsl2591_int report-on-change=true
+#
+# Options are the config names of the example's mbed_app.json, defaults
+# come from there. All sources of the example, its libTSL2591 and sim/
+# are built into _sim/<example>, with sim/ first in the include path so
+# it provides mbed.h. Run the binary with the TSL2591_SIM_* variables of
+# sim/SimBoard.h, e.g. an hour of a light switched every 20 s:
+#
+#   TSL2591_SIM_DURATION=3600 TSL2591_SIM_LIGHT=step:50:5000:20000 _sim/tsl2591 > out.txt
+#
+# CXX and CXXFLAGS are taken from the environment (g++, -O2 -g).
+# sim/check.sh builds and runs the regression checks.
+
+set -e
+
+root=$(cd "$(dirname "$0")/.." && pwd)
+example=${1:?usage: sim/build.sh <example> [option=value ...]}
+shift
+dir=$root/$example
+
+if [ ! -f "$dir/mbed_app.json" ]; then
+  echo "$example: no mbed_app.json" >&2
+  exit 1
+fi
+if [ ! -d "$dir/libTSL2591" ] || [ -z "$(ls -A "$dir/libTSL2591")" ]; then
+  echo "$example: libTSL2591 missing, run git submodule update --init" >&2
+  exit 1
+fi
+
+# The config of mbed_app.json with the overrides as MBED_CONF_APP_* defines, like mbed-cli
+defines=$(python3 - "$dir/mbed_app.json" "$@" <<'EOF'
+import json, sys
+
+config = json.load(open(sys.argv[1])).get("config", {})
+values = {k: (v.get("value") if isinstance(v, dict) else v) for k, v in config.items()}
+for arg in sys.argv[2:]:
+    name, sep, value = arg.partition("=")
+    if not sep or name not in values:
+        sys.exit("unknown option " + arg)
+    values[name] = {"true": True, "false": False, "null": None}.get(value, value)
+for name, value in values.items():
+    if value is None:
+        continue
+    if isinstance(value, bool):
+        value = int(value)
+    print("-DMBED_CONF_APP_%s=%s" % (name.upper().replace("-", "_"), value))
+EOF
+)
+
+libdirs=$(find "$dir/libTSL2591" -name '*.h' -not -path '*/examples/*' -exec dirname {} \; | sort -u | sed 's/^/-I/')
+sources="$(ls "$dir"/*.cpp) $(find "$dir/libTSL2591" -name '*.cpp' -not -path '*/examples/*') $(ls "$root"/sim/*.cpp)"
+
+mkdir -p "$root/_sim"
+${CXX:-g++} -std=gnu++14 ${CXXFLAGS:--O2 -g} -Wall -I"$root/sim" -I"$dir" $libdirs $defines \
+  $sources -o "$root/_sim/$example" -lm
+echo "$root/_sim/$example"
@@ -0,0 +1,62 @@
+#!/bin/sh
+# TSL2591 simulation, regression checks that need the whole stack
+#
+#   sim/check.sh
+#
+# Every check builds an example with sim/build.sh, runs it against the
+# simulated sensor and looks at its output or the summary on stderr.
+# Failed checks are listed, the exit status is the number of them.
+
+set -e
+
+root=$(cd "$(dirname "$0")/.." && pwd)
+failed=0
+
+# check <name> <condition> <message>: condition is a shell test
+check() {
+  if eval "$2"; then
+    echo "ok   $1"
+  else
+    echo "FAIL $1: $3"
+    failed=$((failed + 1))
+  fi
+}
+
+run() {
+  out=$("$root/_sim/$1" 2>&1)
+}
+
+# Continuous mode goes on after a bus recovery, it re-initializes the sensor
+"$root/sim/build.sh" tsl2591 continuous=true bus-recovery=true > /dev/null
+TSL2591_SIM_DURATION=600 TSL2591_SIM_I2C_ERROR_PPM=100000 run tsl2591
+samples=$(echo "$out" | sed -n 's/^Frames: .*  samples: \([0-9]*\) .*/\1/p' | tail -n 1)
+check "continuous across recoveries" "[ \"${samples:-0}\" -ge 1500 ]" "${samples:-0} samples in 600 s"
+
+# Continuous samples carry the gain/timing the sensor really has (250 lux)
+"$root/sim/build.sh" tsl2591 continuous=true > /dev/null
+TSL2591_SIM_DURATION=300 TSL2591_SIM_I2C_ERROR_PPM=300000 run tsl2591
+wrong=$(echo "$out" | grep "Lux: " | grep -cv "Lux: 2\(49\|50\)\." || true)
+check "continuous gain/timing after errors" "[ $wrong -eq 0 ]" "$wrong samples not converted to 250 lux"
+
+# Dual rate: a NACK while servicing INT is retried, events keep coming
+"$root/sim/build.sh" tsl2591_int dual-rate=true > /dev/null
+TSL2591_SIM_DURATION=600 TSL2591_SIM_I2C_ERROR_PPM=20000 run tsl2591_int
+trends=$(echo "$out" | grep -c "^Trend " || true)
+check "dual rate service retry" "[ $trends -ge 60 ]" "$trends trend events in 600 s"
+
+# Dual rate: a level outside the windows isn't reported on every conversion
+TSL2591_SIM_DURATION=30 TSL2591_SIM_LIGHT=const:300 run tsl2591_int
+trends=$(echo "$out" | grep -c "^Trend " || true)
+check "dual rate trend persists" "[ $trends -le 5 ]" "$trends trend events in 30 s"
+TSL2591_SIM_DURATION=30 TSL2591_SIM_LIGHT=const:5000 run tsl2591_int
+alarms=$(echo "$out" | grep -c "^ALARM " || true)
+check "dual rate alarm hold-off" "[ $alarms -le 31 ]" "$alarms alarms in 30 s"
+
+# TSL2591FixedConfig converts like tsl2591MilliLux(), host program without the sim
+libdirs=$(find "$root/tsl2591/libTSL2591" -name '*.h' -not -path '*/examples/*' -exec dirname {} \; | sort -u | sed 's/^/-I/')
+${CXX:-g++} -std=gnu++14 -O2 -Wall -I"$root/sim" -I"$root/tsl2591" $libdirs \
+  "$root/sim/checks/fixed_lux.cpp" "$root/tsl2591/TSL2591FixedLux.cpp" -o "$root/_sim/fixed_lux"
+mismatches=$("$root/_sim/fixed_lux" | wc -l)
+check "fixed config lux" "[ $mismatches -eq 0 ]" "$mismatches mismatches, run _sim/fixed_lux"
+
+exit $failed
@@ -0,0 +1,53 @@
+/* TSL2591 simulation, TSL2591FixedConfig against tsl2591MilliLux() */
+
+/*  Host program of sim/check.sh, built with TSL2591FixedLux.cpp of the
+ *  tsl2591 example. Both integer conversions have to agree exactly for
+ *  every gain/timing over the channel pairs at the edges (0, 1, clipping,
+ *  65534, overflow, ch1 > ch0), lux() must not return NaN or inf.
+ *  Prints the mismatches, the exit status is their number.
+ */
+
+#include "mbed.h"
+#include "TSL2591FixedConfig.h"
+
+static const uint16_t edges[] = { 0, 1, 2, 100, 0x8FFE, 0x8FFF, 0xFFFE, 0xFFFF };
+static int failed = 0;
+
+template <tsl2591Gain_t Gain, tsl2591IntegrationTime_t Timing>
+static void compare(void) {
+  typedef TSL2591FixedConfig<Gain, Timing> Config;
+  for (uint16_t ch0 : edges) {
+    for (uint16_t ch1 : edges) {
+      uint32_t expected = tsl2591MilliLux(ch0, ch1, Gain, Timing);
+      uint32_t mlux = Config::milliLux(ch0, ch1);
+      float lux = Config::lux(ch0, ch1);
+      if (mlux != expected) {
+        printf("gain %x timing %d ch0 %u ch1 %u: milliLux %lu, tsl2591MilliLux %lu\n", Gain, Timing,
+               ch0, ch1, (unsigned long)mlux, (unsigned long)expected);
+        failed++;
+      }
+      if (!isfinite(lux) || (ch0 == 0 && ch1 != 0xFFFF && lux != 0.0F)) {
+        printf("gain %x timing %d ch0 %u ch1 %u: lux %f\n", Gain, Timing, ch0, ch1, lux);
+        failed++;
+      }
+    }
+  }
+}
+
+template <tsl2591Gain_t Gain>
+static void compareTimings(void) {
+  compare<Gain, TSL2591_INTEGRATIONTIME_100MS>();
+  compare<Gain, TSL2591_INTEGRATIONTIME_200MS>();
+  compare<Gain, TSL2591_INTEGRATIONTIME_300MS>();
+  compare<Gain, TSL2591_INTEGRATIONTIME_400MS>();
+  compare<Gain, TSL2591_INTEGRATIONTIME_500MS>();
+  compare<Gain, TSL2591_INTEGRATIONTIME_600MS>();
+}
+
+int main() {
+  compareTimings<TSL2591_GAIN_LOW>();
+  compareTimings<TSL2591_GAIN_MED>();
+  compareTimings<TSL2591_GAIN_HIGH>();
+  compareTimings<TSL2591_GAIN_MAX>();
+  return failed;
+}
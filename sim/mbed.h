@@ -0,0 +1,749 @@
+/* TSL2591 simulation, host build of the subset of Mbed OS 6 the examples use */
+
+#ifndef SIM_MBED_H
+#define SIM_MBED_H
+
+/*  Stands in for mbed-os when an example is built for a Linux host with
+ *  sim/build.sh. The API follows Mbed OS 6.12, implemented on top of a
+ *  simulated time base (see SimKernel.h):
+ *
+ *    - time only advances while every thread sleeps/waits or in busy
+ *      waits (wait_us, I2C transfers), code runs in zero time. A run
+ *      is therefore as fast as the host allows and deterministic.
+ *    - threads are cooperative, a thread runs until it blocks. ISRs
+ *      (InterruptIn, Ticker, Timeout) are called while time advances and
+ *      may wake up a higher priority thread, which then preempts the
+ *      busy waiting one.
+ *    - I2C goes to the devices attached to the simulated bus (SimBus.h),
+ *      by default the TSL2591 model at 0x29 (SimBoard.h).
+ *
+ *  Only what the examples need is here, and no more of it than they need.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include <sys/types.h>
+#include <chrono>
+#include <functional>
+#include <type_traits>
+#include <new>
+
+#include "SimKernel.h"
+
+using namespace std::chrono_literals;
+
+/* Target */
+#define DEVICE_I2C             1
+#define DEVICE_I2C_ASYNCH      0
+#define DEVICE_INTERRUPTIN     1
+#define DEVICE_SERIAL          1
+#define DEVICE_SERIAL_ASYNCH   0
+#define MBED_CPU_STATS_ENABLED 1
+
+#ifndef MBED_CONF_PLATFORM_STDIO_BAUD_RATE
+#define MBED_CONF_PLATFORM_STDIO_BAUD_RATE 115200
+#endif
+
+/* Toolchain */
+#define MBED_ALIGN(n)               __attribute__((aligned(n)))
+#define MBED_PACKED(s)              s __attribute__((packed))
+#define MBED_NOINLINE               __attribute__((noinline))
+#define MBED_FORCEINLINE            static inline __attribute__((always_inline))
+#define MBED_UNUSED                 __attribute__((unused))
+#define MBED_STATIC_ASSERT(e, msg)  static_assert(e, msg)
+#define MBED_ASSERT(e)              assert(e)
+
+extern uint32_t SystemCoreClock;
+
+/**************************************************************************/
+/*
+    Pins, only names. The level of a pin lives in the simulation
+    (sim::pinRead/pinWrite), the TSL2591 model drives its INT pin there.
+*/
+/**************************************************************************/
+#define SIM_PORT(p) p##_0, p##_1, p##_2, p##_3, p##_4, p##_5, p##_6, p##_7, \
+                    p##_8, p##_9, p##_10, p##_11, p##_12, p##_13, p##_14, p##_15
+
+typedef enum {
+  SIM_PORT(PA), SIM_PORT(PB), SIM_PORT(PC), SIM_PORT(PD), SIM_PORT(PE), SIM_PORT(PF), SIM_PORT(PG),
+  D0, D1, D2, D3, D4, D5, D6, D7, D8, D9, D10, D11, D12, D13, D14, D15,
+  A0, A1, A2, A3, A4, A5,
+  LED1, LED2, LED3, BUTTON1,
+  USBTX, USBRX, I2C_SDA, I2C_SCL,
+  SIM_PIN_COUNT,
+  NC = -1
+} PinName;
+
+#undef SIM_PORT
+
+typedef enum { PullNone, PullUp, PullDown, OpenDrain, PullDefault = PullNone } PinMode;
+typedef enum { PIN_INPUT, PIN_OUTPUT } PinDirection;
+
+/* Memory barriers and atomics, the scheduler is cooperative */
+inline void core_util_critical_section_enter(void) {}
+inline void core_util_critical_section_exit(void) {}
+inline uint8_t core_util_atomic_load_u8(const volatile uint8_t *p) { return *p; }
+inline void core_util_atomic_store_u8(volatile uint8_t *p, uint8_t v) { *p = v; }
+inline uint32_t core_util_atomic_load_u32(const volatile uint32_t *p) { return *p; }
+inline void core_util_atomic_store_u32(volatile uint32_t *p, uint32_t v) { *p = v; }
+inline uint32_t core_util_atomic_incr_u32(volatile uint32_t *p, uint32_t d) { return *p += d; }
+inline uint32_t core_util_atomic_decr_u32(volatile uint32_t *p, uint32_t d) { return *p -= d; }
+inline bool core_util_atomic_load_bool(const volatile bool *p) { return *p; }
+inline void core_util_atomic_store_bool(volatile bool *p, bool v) { *p = v; }
+
+/* Sleep and CPU statistics, idle time is the simulated time nobody ran */
+typedef struct {
+  uint64_t uptime;
+  uint64_t idle_time;
+  uint64_t sleep_time;
+  uint64_t deep_sleep_time;
+} mbed_stats_cpu_t;
+
+void mbed_stats_cpu_get(mbed_stats_cpu_t *stats);
+void sleep_manager_lock_deep_sleep(void);
+void sleep_manager_unlock_deep_sleep(void);
+bool sleep_manager_can_deep_sleep(void);
+
+uint32_t us_ticker_read(void);
+void wait_us(int us);
+void thread_sleep_for(uint32_t millisec);
+
+namespace rtos {
+
+typedef int32_t osStatus;
+typedef int32_t osPriority;
+
+enum {
+  osOK = 0,
+  osError = -1,
+  osErrorTimeout = -2,
+  osErrorResource = -3,
+  osErrorParameter = -4,
+  osErrorNoMemory = -5
+};
+
+enum {
+  osPriorityIdle = 1,
+  osPriorityLow = 8,
+  osPriorityBelowNormal = 16,
+  osPriorityNormal = 24,
+  osPriorityAboveNormal = 32,
+  osPriorityHigh = 40,
+  osPriorityRealtime = 48
+};
+
+#define osWaitForever         0xFFFFFFFFU
+#define osFlagsWaitAny        0x00000000U
+#define osFlagsWaitAll        0x00000001U
+#define osFlagsError          0x80000000U
+#define osFlagsErrorUnknown   0xFFFFFFFFU
+#define osFlagsErrorTimeout   0xFFFFFFFEU
+#define osFlagsErrorResource  0xFFFFFFFDU
+#define osFlagsErrorParameter 0xFFFFFFFCU
+#define OS_STACK_SIZE         4096
+
+namespace Kernel {
+struct Clock {
+  typedef std::chrono::milliseconds duration;
+  typedef duration::rep rep;
+  typedef duration::period period;
+  typedef std::chrono::duration<uint32_t, period> duration_u32;
+  typedef std::chrono::time_point<Clock> time_point;
+  static const bool is_steady = true;
+  static time_point now() { return time_point(duration(sim::now() / 1000)); }
+};
+
+constexpr Clock::duration_u32 wait_for_u32_max{osWaitForever - 1};
+constexpr Clock::duration_u32 wait_for_u32_forever{osWaitForever};
+
+inline uint64_t get_ms_count(void) { return sim::now() / 1000; }
+} // namespace Kernel
+
+} // namespace rtos
+
+namespace mbed {
+
+/**************************************************************************/
+/*
+    Callback, a std::function with the constructors of the Mbed one
+*/
+/**************************************************************************/
+template <typename F> class Callback;
+
+template <typename R, typename... ArgTs>
+class Callback<R(ArgTs...)> {
+public:
+  Callback() {}
+  Callback(std::nullptr_t) {}
+
+  template <typename F, typename = typename std::enable_if<
+              !std::is_same<typename std::decay<F>::type, Callback>::value>::type>
+  Callback(F f) : _f(f) {}
+
+  template <typename T, typename U>
+  Callback(U *obj, R (T::*method)(ArgTs...))
+    : _f([obj, method](ArgTs... args) -> R { return (obj->*method)(args...); }) {}
+
+  template <typename T, typename U>
+  Callback(const U *obj, R (T::*method)(ArgTs...) const)
+    : _f([obj, method](ArgTs... args) -> R { return (obj->*method)(args...); }) {}
+
+  R call(ArgTs... args) const { return _f(args...); }
+  R operator()(ArgTs... args) const { return _f(args...); }
+  explicit operator bool() const { return (bool)_f; }
+
+private:
+  std::function<R(ArgTs...)> _f;
+};
+
+template <typename R, typename... ArgTs>
+Callback<R(ArgTs...)> callback(R (*func)(ArgTs...)) {
+  return Callback<R(ArgTs...)>(func);
+}
+
+template <typename R, typename... ArgTs>
+Callback<R(ArgTs...)> callback(const Callback<R(ArgTs...)> &func) {
+  return func;
+}
+
+template <typename T, typename U, typename R, typename... ArgTs>
+Callback<R(ArgTs...)> callback(U *obj, R (T::*method)(ArgTs...)) {
+  return Callback<R(ArgTs...)>(obj, method);
+}
+
+template <typename T, typename U, typename R, typename... ArgTs>
+Callback<R(ArgTs...)> callback(const U *obj, R (T::*method)(ArgTs...) const) {
+  return Callback<R(ArgTs...)>(obj, method);
+}
+
+typedef Callback<void(int)> event_callback_t;
+
+class NonCopyable {
+protected:
+  NonCopyable() {}
+  ~NonCopyable() {}
+  NonCopyable(const NonCopyable &) = delete;
+  NonCopyable &operator=(const NonCopyable &) = delete;
+};
+
+class CriticalSectionLock {
+public:
+  CriticalSectionLock() { core_util_critical_section_enter(); }
+  ~CriticalSectionLock() { core_util_critical_section_exit(); }
+};
+
+/**************************************************************************/
+/*
+    Digital pins
+*/
+/**************************************************************************/
+class DigitalIn {
+public:
+  DigitalIn(PinName pin, PinMode mode = PullDefault) : _pin(pin) { this->mode(mode); }
+  int read(void) { return sim::pinRead(_pin); }
+  void mode(PinMode mode) { sim::pinMode(_pin, mode); }
+  int is_connected(void) { return _pin != NC; }
+  operator int() { return read(); }
+
+private:
+  PinName _pin;
+};
+
+class DigitalOut {
+public:
+  DigitalOut(PinName pin, int value = 0) : _pin(pin) { write(value); }
+  void write(int value) { sim::pinWrite(_pin, value); }
+  int read(void) { return sim::pinRead(_pin); }
+  int is_connected(void) { return _pin != NC; }
+  DigitalOut &operator=(int value) { write(value); return *this; }
+  operator int() { return read(); }
+
+private:
+  PinName _pin;
+};
+
+class DigitalInOut {
+public:
+  DigitalInOut(PinName pin) : _pin(pin) { input(); }
+  DigitalInOut(PinName pin, PinDirection direction, PinMode mode, int value) : _pin(pin) {
+    this->mode(mode);
+    if (direction == PIN_OUTPUT) {
+      output();
+      write(value);
+    } else {
+      input();
+    }
+  }
+  void write(int value) { sim::pinWrite(_pin, value); }
+  int read(void) { return sim::pinRead(_pin); }
+  void output(void) {}
+  void input(void) { sim::pinRelease(_pin); }
+  void mode(PinMode mode) { sim::pinMode(_pin, mode); }
+  int is_connected(void) { return _pin != NC; }
+  DigitalInOut &operator=(int value) { write(value); return *this; }
+  operator int() { return read(); }
+
+private:
+  PinName _pin;
+};
+
+/**************************************************************************/
+/*
+    Edge interrupts of a simulated pin, the handlers run in ISR context
+    while the simulation advances
+*/
+/**************************************************************************/
+class InterruptIn : private NonCopyable {
+public:
+  InterruptIn(PinName pin);
+  InterruptIn(PinName pin, PinMode mode);
+  ~InterruptIn();
+
+  int read(void) { return sim::pinRead(_pin); }
+  void mode(PinMode mode) { sim::pinMode(_pin, mode); }
+  void rise(Callback<void()> func) { _rise = func; }
+  void fall(Callback<void()> func) { _fall = func; }
+  void enable_irq(void) { _enabled = true; }
+  void disable_irq(void) { _enabled = false; }
+  operator int() { return read(); }
+
+  /* Called by the simulation on an edge of the pin */
+  void edge(int level);
+
+private:
+  PinName _pin;
+  bool _enabled;
+  Callback<void()> _rise;
+  Callback<void()> _fall;
+};
+
+/**************************************************************************/
+/*
+    I2C master on the simulated bus (SimBus.h). Transfers take the time
+    the bytes need at the configured clock, busy waiting like the HAL.
+*/
+/**************************************************************************/
+class I2C : private NonCopyable {
+public:
+  enum Acknowledge { NoACK = 0, ACK = 1 };
+
+  I2C(PinName sda, PinName scl);
+
+  void frequency(int hz);
+  int read(int address, char *data, int length, bool repeated = false);
+  int read(int ack);
+  int write(int address, const char *data, int length, bool repeated = false);
+  int write(int data);
+  void start(void);
+  void stop(void);
+  void lock(void) {}
+  void unlock(void) {}
+
+private:
+  void byteTime(int bytes);
+
+  int _hz;
+  bool _addressNext;
+  bool _writing;
+};
+
+/**************************************************************************/
+/*
+    Timers on the simulated clock
+*/
+/**************************************************************************/
+class Timer {
+public:
+  Timer() : _running(false), _start(0), _elapsed(0) {}
+  void start(void) {
+    if (!_running) {
+      _start = sim::now();
+      _running = true;
+    }
+  }
+  void stop(void) {
+    if (_running) {
+      _elapsed += sim::now() - _start;
+      _running = false;
+    }
+  }
+  void reset(void) {
+    _start = sim::now();
+    _elapsed = 0;
+  }
+  std::chrono::microseconds elapsed_time(void) const {
+    return std::chrono::microseconds(_elapsed + (_running ? sim::now() - _start : 0));
+  }
+  int read_us(void) const { return (int)elapsed_time().count(); }
+  int read_ms(void) const { return (int)(elapsed_time().count() / 1000); }
+
+private:
+  bool _running;
+  uint64_t _start;
+  uint64_t _elapsed;
+};
+
+class Timeout : private NonCopyable {
+public:
+  Timeout() : _id(0) {}
+  ~Timeout() { detach(); }
+  void attach(Callback<void()> func, std::chrono::microseconds t);
+  void detach(void);
+
+protected:
+  virtual void handler(void);
+  void arm(uint64_t at);
+
+  Callback<void()> _func;
+  int _id;
+  std::chrono::microseconds _period;
+};
+
+class Ticker : public Timeout {
+protected:
+  void handler(void) override;
+};
+
+/**************************************************************************/
+/*
+    Buffered UART, everything written goes to stdout
+*/
+/**************************************************************************/
+class BufferedSerial : private NonCopyable {
+public:
+  BufferedSerial(PinName tx, PinName rx, int baud = MBED_CONF_PLATFORM_STDIO_BAUD_RATE) { (void)tx; (void)rx; (void)baud; }
+
+  ssize_t write(const void *buffer, size_t length);
+  ssize_t read(void *buffer, size_t length) { (void)buffer; (void)length; return -11; } // -EAGAIN
+  int set_blocking(bool blocking) { (void)blocking; return 0; }
+  int sync(void) { return fflush(stdout); }
+  void set_baud(int baud) { (void)baud; }
+  bool readable(void) const { return false; }
+  bool writable(void) const { return true; }
+};
+
+/**************************************************************************/
+/*
+    CRC, only the 32 bit ANSI polynomial (zlib crc32)
+*/
+/**************************************************************************/
+typedef enum crc_polynomial {
+  POLY_7BIT_SD = 0x09,
+  POLY_8BIT_CCITT = 0x07,
+  POLY_16BIT_CCITT = 0x1021,
+  POLY_16BIT_IBM = 0x8005,
+  POLY_32BIT_ANSI = 0x04C11DB7
+} crc_polynomial_t;
+
+template <uint32_t polynomial = POLY_32BIT_ANSI, int width = 32>
+class MbedCRC {
+  static_assert(polynomial == POLY_32BIT_ANSI && width == 32, "only POLY_32BIT_ANSI is simulated");
+
+public:
+  int32_t compute(const void *buffer, unsigned long size, uint32_t *crc) {
+    uint32_t c = 0xFFFFFFFF;
+    const uint8_t *p = (const uint8_t *)buffer;
+    for (unsigned long i = 0; i < size; i++) {
+      c ^= p[i];
+      for (int b = 0; b < 8; b++) {
+        c = (c >> 1) ^ (0xEDB88320 & (0 - (c & 1)));
+      }
+    }
+    *crc = ~c;
+    return 0;
+  }
+};
+
+} // namespace mbed
+
+namespace events {
+
+#define EVENTS_EVENT_SIZE (64)
+
+/**************************************************************************/
+/*
+    EventQueue, events are kept in deadline order. The capacity follows
+    the size passed in (one event per EVENTS_EVENT_SIZE), a full queue
+    drops the call and returns 0 like the real one.
+*/
+/**************************************************************************/
+class EventQueue : private mbed::NonCopyable {
+public:
+  EventQueue(unsigned size = 32 * EVENTS_EVENT_SIZE, unsigned char *buffer = NULL);
+  ~EventQueue();
+
+  void dispatch(int ms = -1);
+  void dispatch_forever(void) { dispatch(-1); }
+  void dispatch_once(void) { dispatch(0); }
+  void break_dispatch(void);
+  bool cancel(int id);
+  int time_left(int id);
+
+  template <typename F, typename... ArgTs>
+  int call(F f, ArgTs... args) {
+    return post(0, -1, bind(f, args...));
+  }
+
+  template <typename Rep, typename Period, typename F, typename... ArgTs>
+  int call_in(std::chrono::duration<Rep, Period> t, F f, ArgTs... args) {
+    return post(toUs(t), -1, bind(f, args...));
+  }
+
+  template <typename Rep, typename Period, typename F, typename... ArgTs>
+  int call_every(std::chrono::duration<Rep, Period> t, F f, ArgTs... args) {
+    return post(toUs(t), toUs(t), bind(f, args...));
+  }
+
+  template <typename F>
+  mbed::Callback<void()> event(F f) {
+    return [this, f]() { call(f); };
+  }
+
+  template <typename T, typename R, typename... ArgTs>
+  mbed::Callback<void(ArgTs...)> event(T *obj, R (T::*method)(ArgTs...)) {
+    return [this, obj, method](ArgTs... args) { call(obj, method, args...); };
+  }
+
+private:
+  struct Event;
+
+  /* Functions, callbacks and (object, method) pairs with their arguments */
+  template <typename F, typename... ArgTs>
+  static std::function<void()> bind(F f, ArgTs... args) {
+    return std::bind(f, args...);
+  }
+
+  template <typename T, typename U, typename R, typename... BoundTs, typename... ArgTs>
+  static std::function<void()> bind(U *obj, R (T::*method)(BoundTs...), ArgTs... args) {
+    return std::bind(method, obj, args...);
+  }
+
+  template <typename Rep, typename Period>
+  static int64_t toUs(std::chrono::duration<Rep, Period> t) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(t).count();
+  }
+
+  int post(int64_t delay, int64_t period, std::function<void()> fn);
+  void insert(Event *e);
+
+  Event *_events;
+  sim::WaitList _dispatcher;
+  unsigned _capacity;
+  unsigned _count;
+  int _nextId;
+  int _running;
+  bool _cancelRunning;
+  bool _break;
+};
+
+} // namespace events
+
+namespace rtos {
+
+/**************************************************************************/
+/*
+    Threads and synchronisation on the cooperative scheduler
+*/
+/**************************************************************************/
+class Thread : private mbed::NonCopyable {
+public:
+  Thread(osPriority priority = osPriorityNormal, uint32_t stack_size = OS_STACK_SIZE,
+         unsigned char *stack_mem = nullptr, const char *name = nullptr);
+  ~Thread();
+
+  osStatus start(mbed::Callback<void()> task);
+  osStatus join(void);
+  osStatus terminate(void);
+  osStatus set_priority(osPriority priority);
+  osPriority get_priority(void) const;
+  uint32_t stack_size(void) const { return _stackSize; }
+  const char *get_name(void) const { return _name; }
+
+private:
+  osPriority _priority;
+  uint32_t _stackSize;
+  const char *_name;
+  sim::Task *_task;
+};
+
+class Mutex : private mbed::NonCopyable {
+public:
+  Mutex() : _owner(nullptr), _count(0) {}
+  Mutex(const char *name) : _owner(nullptr), _count(0) { (void)name; }
+
+  void lock(void);
+  bool trylock(void);
+  bool trylock_for(Kernel::Clock::duration_u32 rel_time);
+  void unlock(void);
+
+private:
+  bool take(uint64_t deadline);
+
+  sim::Task *_owner;
+  uint32_t _count;
+  sim::WaitList _waiters;
+};
+
+class Semaphore : private mbed::NonCopyable {
+public:
+  Semaphore(int32_t count = 0, uint16_t max_count = 0xFFFF) : _count(count), _max(max_count) {}
+
+  void acquire(void) { take(sim::FOREVER); }
+  bool try_acquire(void) { return take(sim::now()); }
+  bool try_acquire_for(Kernel::Clock::duration_u32 rel_time) { return take(sim::deadline(rel_time)); }
+  bool try_acquire_until(Kernel::Clock::time_point abs_time) { return take(sim::deadline(abs_time)); }
+  osStatus release(void);
+
+private:
+  bool take(uint64_t deadline);
+
+  int32_t _count;
+  uint16_t _max;
+  sim::WaitList _waiters;
+};
+
+class EventFlags : private mbed::NonCopyable {
+public:
+  EventFlags() : _flags(0) {}
+  EventFlags(const char *name) : _flags(0) { (void)name; }
+
+  uint32_t set(uint32_t flags);
+  uint32_t clear(uint32_t flags = 0x7fffffff);
+  uint32_t get(void) const { return _flags; }
+  uint32_t wait_all(uint32_t flags = 0, uint32_t millisec = osWaitForever, bool clear = true) {
+    return wait(flags, sim::deadline(Kernel::Clock::duration_u32(millisec)), clear, true);
+  }
+  uint32_t wait_any(uint32_t flags = 0, uint32_t millisec = osWaitForever, bool clear = true) {
+    return wait(flags, sim::deadline(Kernel::Clock::duration_u32(millisec)), clear, false);
+  }
+  uint32_t wait_all_for(uint32_t flags, Kernel::Clock::duration_u32 rel_time, bool clear = true) {
+    return wait(flags, sim::deadline(rel_time), clear, true);
+  }
+  uint32_t wait_any_for(uint32_t flags, Kernel::Clock::duration_u32 rel_time, bool clear = true) {
+    return wait(flags, sim::deadline(rel_time), clear, false);
+  }
+
+private:
+  uint32_t wait(uint32_t flags, uint64_t deadline, bool clear, bool all);
+
+  uint32_t _flags;
+  sim::WaitList _waiters;
+};
+
+template <typename T, uint32_t queue_sz>
+class Queue : private mbed::NonCopyable {
+public:
+  Queue() : _head(0), _count(0) {}
+
+  bool empty(void) const { return _count == 0; }
+  bool full(void) const { return _count == queue_sz; }
+  uint32_t count(void) const { return _count; }
+
+  bool try_put(T *data) {
+    if (full()) {
+      return false;
+    }
+    _items[(_head + _count++) % queue_sz] = data;
+    sim::wakeOne(_getters);
+    return true;
+  }
+
+  bool try_put_for(Kernel::Clock::duration_u32 rel_time, T *data) {
+    uint64_t until = sim::deadline(rel_time);
+    while (full()) {
+      if (!sim::block(&_putters, until)) {
+        return false;
+      }
+    }
+    return try_put(data);
+  }
+
+  bool try_get(T **data_out) {
+    if (empty()) {
+      return false;
+    }
+    *data_out = _items[_head];
+    _head = (_head + 1) % queue_sz;
+    _count--;
+    sim::wakeOne(_putters);
+    return true;
+  }
+
+  bool try_get_for(Kernel::Clock::duration_u32 rel_time, T **data_out) {
+    uint64_t until = sim::deadline(rel_time);
+    while (empty()) {
+      if (!sim::block(&_getters, until)) {
+        return false;
+      }
+    }
+    return try_get(data_out);
+  }
+
+private:
+  T *_items[queue_sz];
+  uint32_t _head;
+  uint32_t _count;
+  sim::WaitList _getters;
+  sim::WaitList _putters;
+};
+
+template <typename T, uint32_t pool_sz>
+class MemoryPool : private mbed::NonCopyable {
+public:
+  MemoryPool() : _free(pool_sz) {
+    for (uint32_t i = 0; i < pool_sz; i++) {
+      _stack[i] = pool_sz - 1 - i;
+    }
+  }
+
+  T *try_alloc(void) {
+    if (_free == 0) {
+      return nullptr;
+    }
+    return reinterpret_cast<T *>(&_blocks[_stack[--_free]]);
+  }
+  T *alloc(void) { return try_alloc(); }
+  T *try_calloc(void) {
+    T *block = try_alloc();
+    if (block) {
+      memset((void *)block, 0, sizeof(T));
+    }
+    return block;
+  }
+
+  osStatus free(T *block) {
+    size_t index = reinterpret_cast<Block *>(block) - _blocks;
+    if (block == nullptr || index >= pool_sz || _free == pool_sz) {
+      return osErrorParameter;
+    }
+    _stack[_free++] = (uint32_t)index;
+    return osOK;
+  }
+
+private:
+  typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type Block;
+
+  Block _blocks[pool_sz];
+  uint32_t _stack[pool_sz];
+  uint32_t _free;
+};
+
+namespace ThisThread {
+void sleep_for(Kernel::Clock::duration_u32 rel_time);
+void sleep_until(Kernel::Clock::time_point abs_time);
+void yield(void);
+const char *get_name(void);
+} // namespace ThisThread
+
+} // namespace rtos
+
+using namespace mbed;
+using namespace events;
+using namespace rtos;
+
+#endif
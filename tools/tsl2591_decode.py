@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+"""Decodes the binary TSL2591 sample stream (see TSL2591BinaryStream.h).
+
+Reads from a serial port (needs pyserial) or a captured file / stdin and
+prints one CSV line per valid frame. Bytes that are not part of a valid
+frame (console text, partial frames) are skipped, lost frames are
+reported from gaps in the sequence number.
+
+    tools/tsl2591_decode.py --port /dev/ttyACM0 --baud 115200
+    tools/tsl2591_decode.py capture.bin
+"""
+
+import argparse
+import struct
+import sys
+
+SYNC = b"\xa5\x5a"
+FRAME_SIZE = 18
+GAIN = {0x00: 1.0, 0x10: 25.0, 0x20: 428.0, 0x30: 9876.0}
+LUX_DF = 408.0
+
+
+def crc16(data):
+    crc = 0xFFFF
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+            crc &= 0xFFFF
+    return crc
+
+
+def lux(full, ir, gain, timing):
+    # Same formula as Adafruit_TSL2591::calculateLux()
+    if full == 0xFFFF or ir == 0xFFFF:
+        return -1.0
+    if full == 0:
+        return 0.0
+    cpl = (100.0 * (timing + 1)) * GAIN.get(gain, 1.0) / LUX_DF
+    return (full - ir) * (1.0 - ir / full) / cpl
+
+
+def frames(stream, live=False):
+    # A serial port returns nothing after its timeout, only a file ends
+    buf = b""
+    while True:
+        chunk = stream.read(256)
+        if not chunk:
+            if live:
+                continue
+            return
+        buf += chunk
+        while len(buf) >= FRAME_SIZE:
+            start = buf.find(SYNC)
+            if start < 0:
+                buf = buf[-1:]
+                break
+            if len(buf) - start < FRAME_SIZE:
+                buf = buf[start:]
+                break
+            frame = buf[start:start + FRAME_SIZE]
+            (crc,) = struct.unpack_from("<H", frame, 16)
+            if crc16(frame[2:16]) != crc:
+                buf = buf[start + 1:]
+                continue
+            buf = buf[start + FRAME_SIZE:]
+            yield struct.unpack_from("<HIHHBBBB", frame, 2)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("file", nargs="?", help="captured stream, default stdin")
+    parser.add_argument("--port", help="serial port to read from")
+    parser.add_argument("--baud", type=int, default=115200)
+    args = parser.parse_args()
+
+    if args.port:
+        import serial
+        stream = serial.Serial(args.port, args.baud, timeout=1)
+    elif args.file:
+        stream = open(args.file, "rb")
+    else:
+        stream = sys.stdin.buffer
+
+    print("seq,timestamp_ms,full,ir,visible,gain,timing,lux,flags,retries")
+    last = None
+    lost = 0
+    for seq, ts, full, ir, gain, timing, flags, retries in frames(stream, args.port is not None):
+        if last is not None and seq != (last + 1) & 0xFFFF:
+            lost += (seq - last - 1) & 0xFFFF
+            print("# lost %d frame(s), %d total" % ((seq - last - 1) & 0xFFFF, lost), file=sys.stderr)
+        last = seq
+        print("%d,%d,%d,%d,%d,%d,%d,%.4f,%d,%d" % (seq, ts, full, ir, full - ir, gain, timing,
+                                                  lux(full, ir, gain, timing), flags, retries))
+
+
+if __name__ == "__main__":
+    main()
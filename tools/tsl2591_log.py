@@ -0,0 +1,63 @@
+#!/usr/bin/env python3
+"""Reads a TSL2591 sample log (see TSL2591Logger.h) from a device image.
+
+The log is a ring of 512 byte blocks. Every valid block (magic and
+CRC-32 ok) is collected, sorted by its sequence number and the records
+are printed as CSV, oldest first. Gaps in the sequence numbers (blocks
+overwritten or lost) are reported on stderr.
+
+    sudo dd if=/dev/sdX of=sd.img bs=1M count=1
+    tools/tsl2591_log.py sd.img
+    tools/tsl2591_log.py --start 0x100000 --size 0x100000 qspi.bin
+"""
+
+import argparse
+import struct
+import sys
+import zlib
+
+from tsl2591_decode import lux
+
+BLOCK_SIZE = 512
+HEADER = struct.Struct("<IIHHI")
+RECORD = struct.Struct("<IHHBBBB")
+MAGIC = 0x474C5354
+
+
+def blocks(image, start, size):
+    for offset in range(start, start + size - BLOCK_SIZE + 1, BLOCK_SIZE):
+        block = image[offset:offset + BLOCK_SIZE]
+        magic, seq, count, _, crc = HEADER.unpack_from(block)
+        if magic != MAGIC or count > (BLOCK_SIZE - HEADER.size) // RECORD.size:
+            continue
+        check = block[:12] + b"\0\0\0\0" + block[16:]
+        if zlib.crc32(check) & 0xFFFFFFFF != crc:
+            continue
+        records = [RECORD.unpack_from(block, HEADER.size + i * RECORD.size) for i in range(count)]
+        yield seq, records
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("image", help="raw image of the log device")
+    parser.add_argument("--start", type=lambda x: int(x, 0), default=0, help="log region offset")
+    parser.add_argument("--size", type=lambda x: int(x, 0), default=0, help="log region size, 0 = rest of the image")
+    args = parser.parse_args()
+
+    with open(args.image, "rb") as f:
+        image = f.read()
+    size = args.size or len(image) - args.start
+
+    print("block,timestamp_ms,full,ir,visible,gain,timing,lux,flags,retries")
+    last = None
+    for seq, records in sorted(blocks(image, args.start, size)):
+        if last is not None and seq != last + 1:
+            print("# %d block(s) missing before block %d" % (seq - last - 1, seq), file=sys.stderr)
+        last = seq
+        for ts, full, ir, gain, timing, flags, retries in records:
+            print("%d,%d,%d,%d,%d,%d,%d,%.4f,%d,%d" % (seq, ts, full, ir, full - ir, gain, timing,
+                                                      lux(full, ir, gain, timing), flags, retries))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,173 @@
+#!/usr/bin/env python3
+"""Reports flash and RAM per component from a GCC_ARM map file.
+
+Every input section of the memory map is charged to the component of
+its object file: each source file of the example (tsl2591.o,
+TSL2591Registers.o, ...), the libTSL2591 driver, the top level
+directories of Mbed OS (rtos, drivers, platform, targets, ...) and the
+toolchain libraries. Flash is code, read-only data and the load image of
+.data, RAM is .data and .bss. Heap and main stack are the regions the
+linker script reserves, reported apart. The sensor stack is everything
+but Mbed OS and the toolchain, the part --max-flash / --max-ram check.
+
+    mbed compile -m NUCLEO_F767ZI -t GCC_ARM --app-config mbed_app_minimal.json
+    tools/tsl2591_size.py BUILD/NUCLEO_F767ZI/GCC_ARM/tsl2591.map
+    tools/tsl2591_size.py --max-flash 12288 --max-ram 2048 tsl2591.map
+    tools/tsl2591_size.py --json tsl2591.map > size.json
+"""
+
+import argparse
+import json
+import os
+import re
+import sys
+
+# Output sections by what they take
+FLASH_SECTIONS = (".isr_vector", ".text", ".rodata", ".ARM.extab", ".ARM.exidx", ".copy.table", ".zero.table",
+                  ".init_array", ".fini_array", ".preinit_array")
+DATA_SECTIONS = (".data",)
+BSS_SECTIONS = (".bss", ".uninitialized", ".noinit")
+# Sized by the linker script, not by their input sections
+RESERVED = {".heap": "heap", ".stack_dummy": "stack", ".stack": "stack"}
+
+TOOLCHAIN = re.compile(r"(lib(c|c_nano|g|g_nano|m|stdc\+\+|stdc\+\+_nano|supc\+\+|supc\+\+_nano|gcc|nosys|rdimon)"
+                       r")\.a\(|crt[^/]*\.o$")
+MBED_OS = re.compile(r"(^|/)mbed-os[^/]*/([^/]+)/")
+
+INPUT = re.compile(r"^ (\S+)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$")
+INPUT_NAME = re.compile(r"^ (\S+)$")
+INPUT_CONT = re.compile(r"^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$")
+OUTPUT = re.compile(r"^(\.\S+)(\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+))?")
+
+
+def component(path):
+    path = path.replace("\\", "/")
+    m = TOOLCHAIN.search(path)
+    if m:
+        return "toolchain/" + (m.group(1) if m.group(1) else "crt")
+    if "/libTSL2591/" in path or path.startswith("libTSL2591/"):
+        return "libTSL2591"
+    m = MBED_OS.search(path)
+    if m:
+        return "mbed-os/" + m.group(2)
+    if path.startswith("linker stubs") or path.startswith("*"):
+        return "linker"
+    # An object of the example itself
+    name = os.path.basename(path.split("(")[0])
+    return os.path.splitext(name)[0]
+
+
+def kind(section):
+    if section.startswith(FLASH_SECTIONS):
+        return "flash"
+    if section.startswith(DATA_SECTIONS):
+        return "data"
+    if section.startswith(BSS_SECTIONS):
+        return "bss"
+    return None
+
+
+def parse(lines):
+    sizes = {}
+    reserved = {}
+    output = None
+    pending = None
+    started = False
+
+    def charge(path, size):
+        k = kind(output)
+        if not k or size == 0:
+            return
+        entry = sizes.setdefault(component(path), {"flash": 0, "data": 0, "bss": 0})
+        entry[k] += size
+
+    for line in lines:
+        line = line.rstrip("\n")
+        if not started:
+            started = line.startswith("Linker script and memory map")
+            continue
+        if pending:
+            m = INPUT_CONT.match(line)
+            pending = None
+            if m:
+                charge(m.group(3), int(m.group(2), 16))
+                continue
+        m = OUTPUT.match(line)
+        if m:
+            output = m.group(1)
+            if output in RESERVED and m.group(4):
+                reserved[RESERVED[output]] = reserved.get(RESERVED[output], 0) + int(m.group(4), 16)
+            continue
+        if output is None or line.startswith(" *(") or " *fill*" in line:
+            continue
+        m = INPUT.match(line)
+        if m:
+            charge(m.group(4), int(m.group(3), 16))
+            continue
+        if INPUT_NAME.match(line):
+            # Long section name, address, size and file follow on the next line
+            pending = line
+    if not started:
+        raise ValueError("no memory map, not a GNU ld map file?")
+    return sizes, reserved
+
+
+def group(name):
+    if name.startswith("mbed-os/"):
+        return "mbed-os"
+    if name.startswith("toolchain/") or name == "linker":
+        return "toolchain"
+    return "sensor"
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("map", help="map file of the GCC_ARM build")
+    parser.add_argument("--json", action="store_true", help="print the numbers as JSON")
+    parser.add_argument("--max-flash", type=int, help="flash budget of the sensor stack in bytes")
+    parser.add_argument("--max-ram", type=int, help="static RAM budget of the sensor stack in bytes")
+    args = parser.parse_args()
+
+    with open(args.map, errors="replace") as f:
+        try:
+            sizes, reserved = parse(f)
+        except ValueError as e:
+            sys.exit("%s: %s" % (args.map, e))
+
+    rows = []
+    for name, s in sizes.items():
+        rows.append({"component": name, "group": group(name), "flash": s["flash"] + s["data"],
+                     "ram": s["data"] + s["bss"], "text": s["flash"], "data": s["data"], "bss": s["bss"]})
+    rows.sort(key=lambda r: ({"sensor": 0, "mbed-os": 1, "toolchain": 2}[r["group"]], -r["flash"], r["component"]))
+    totals = {}
+    for g in ("sensor", "mbed-os", "toolchain"):
+        totals[g] = {"flash": sum(r["flash"] for r in rows if r["group"] == g),
+                     "ram": sum(r["ram"] for r in rows if r["group"] == g)}
+    totals["total"] = {"flash": sum(t["flash"] for t in totals.values()),
+                       "ram": sum(t["ram"] for t in totals.values())}
+
+    if args.json:
+        json.dump({"components": rows, "totals": totals, "reserved": reserved}, sys.stdout, indent=2)
+        print()
+    else:
+        print("%-28s %8s %8s %8s %8s %8s" % ("component", "flash", "ram", "text", "data", "bss"))
+        for r in rows:
+            print("%-28s %8d %8d %8d %8d %8d" % (r["component"], r["flash"], r["ram"], r["text"], r["data"], r["bss"]))
+        print()
+        for g in ("sensor", "mbed-os", "toolchain", "total"):
+            print("%-28s %8d %8d" % (g, totals[g]["flash"], totals[g]["ram"]))
+        for name in sorted(reserved):
+            print("%-28s %8s %8d" % ("reserved " + name, "", reserved[name]))
+
+    failed = False
+    if args.max_flash is not None and totals["sensor"]["flash"] > args.max_flash:
+        print("sensor stack flash %d > budget %d" % (totals["sensor"]["flash"], args.max_flash), file=sys.stderr)
+        failed = True
+    if args.max_ram is not None and totals["sensor"]["ram"] > args.max_ram:
+        print("sensor stack RAM %d > budget %d" % (totals["sensor"]["ram"], args.max_ram), file=sys.stderr)
+        failed = True
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
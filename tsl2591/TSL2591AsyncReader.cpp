@@ -0,0 +1,77 @@
+/* TSL2591 Digital Light Sensor, non-blocking full luminosity read */
+
+#include "TSL2591AsyncReader.h"
+
+#if DEVICE_I2C_ASYNCH
+
+TSL2591AsyncReader::TSL2591AsyncReader(Adafruit_TSL2591 &tsl, I2C &i2c, EventQueue &queue)
+  : _tsl(tsl), _regs(i2c), _queue(queue), _busy(false), _event(0), _tx(0) {
+}
+
+/**************************************************************************/
+/*
+    Enables the ALS and schedules the channel readout for the end of the
+    current integration time
+*/
+/**************************************************************************/
+bool TSL2591AsyncReader::start(done_callback_t done) {
+  if (_busy) {
+    return false;
+  }
+  _busy = true;
+  _done = done;
+
+  _regs.write8(TSL2591_REGISTER_ENABLE, TSL2591_ENABLE_POWERON | TSL2591_ENABLE_AEN);
+
+  // Same margin as getFullLuminosity(), the ADC data is valid when we read it
+  _queue.call_in(TSL2591Registers::conversionTime(_tsl.getTiming()), this, &TSL2591AsyncReader::readChannels);
+  return true;
+}
+
+/**************************************************************************/
+/*
+    Reads C0DATAL..C1DATAH in one auto-increment transfer, the I2C driver
+    calls onTransfer() from interrupt context when it is done
+*/
+/**************************************************************************/
+void TSL2591AsyncReader::readChannels(void) {
+  _tx = TSL2591_COMMAND_BIT | TSL2591_REGISTER_CHAN0_LOW;
+  int err = _regs.i2c().transfer(_regs.address() << 1, &_tx, 1, _rx, sizeof(_rx),
+                          callback(this, &TSL2591AsyncReader::onTransfer),
+                          I2C_EVENT_ALL);
+  if (err) {
+    // Bus is busy with another asynchronous transfer
+    _event = I2C_EVENT_ERROR;
+    complete();
+  }
+}
+
+void TSL2591AsyncReader::onTransfer(int event) {
+  TSL2591_TRACE_POINT(TSL2591_TRACE_ISR_BEGIN, 0, event);
+  _event = event;
+  _queue.call(this, &TSL2591AsyncReader::complete);
+  TSL2591_TRACE_POINT(TSL2591_TRACE_ISR_END, 0, 0);
+}
+
+/**************************************************************************/
+/*
+    Powers the ALS down again (like getFullLuminosity() does) and hands
+    the result to the user, runs in the context of the event queue
+*/
+/**************************************************************************/
+void TSL2591AsyncReader::complete(void) {
+  _regs.write8(TSL2591_REGISTER_ENABLE, TSL2591_ENABLE_POWEROFF);
+
+  int status = (_event & I2C_EVENT_TRANSFER_COMPLETE) ? 0 : _event;
+  uint32_t lum = 0;
+  if (status == 0) {
+    lum = TSL2591Registers::packChannels(_rx);
+  }
+
+  _busy = false;
+  if (_done) {
+    _done(status, lum);
+  }
+}
+
+#endif // DEVICE_I2C_ASYNCH
@@ -0,0 +1,56 @@
+/* TSL2591 Digital Light Sensor, non-blocking full luminosity read */
+
+#ifndef TSL2591_ASYNC_READER_H
+#define TSL2591_ASYNC_READER_H
+
+#include "mbed.h"
+#include "Adafruit_TSL2591.h"
+#include "TSL2591Registers.h"
+
+#if DEVICE_I2C_ASYNCH
+
+/**************************************************************************/
+/*
+    Non-blocking counterpart of Adafruit_TSL2591::getFullLuminosity().
+
+    start() powers the ALS up and returns immediately. When the
+    integration time configured with setGain()/setTiming() has passed,
+    both ADC channels are fetched with I2C::transfer and the callback is
+    called from the event queue with the same packed value
+    getFullLuminosity() returns (top 16 bits IR, bottom 16 bits full
+    spectrum). status is 0 on success, otherwise the I2C_EVENT_* flags of
+    the failed transfer.
+
+    The sensor (and its settings) is owned by the Adafruit_TSL2591 object,
+    don't call any of its read functions while a read is pending.
+*/
+/**************************************************************************/
+class TSL2591AsyncReader {
+public:
+  typedef Callback<void(int status, uint32_t lum)> done_callback_t;
+
+  TSL2591AsyncReader(Adafruit_TSL2591 &tsl, I2C &i2c, EventQueue &queue);
+
+  /* Starts a conversion, returns false if one is already pending */
+  bool start(done_callback_t done);
+
+  bool busy(void) const { return _busy; }
+
+private:
+  void readChannels(void);
+  void onTransfer(int event);
+  void complete(void);
+
+  Adafruit_TSL2591 &_tsl;
+  TSL2591Registers _regs;
+  EventQueue &_queue;
+  done_callback_t _done;
+  volatile bool _busy;
+  volatile int _event;
+  char _tx;
+  char _rx[4];
+};
+
+#endif // DEVICE_I2C_ASYNCH
+
+#endif
@@ -0,0 +1,127 @@
+/* TSL2591 Digital Light Sensor, automatic gain and integration time */
+
+#include "TSL2591AutoRange.h"
+
+static const tsl2591Gain_t gains[] = {
+  TSL2591_GAIN_LOW, TSL2591_GAIN_MED, TSL2591_GAIN_HIGH, TSL2591_GAIN_MAX
+};
+
+TSL2591AutoRange::TSL2591AutoRange(TSL2591Registers &regs, uint16_t minCounts, uint8_t highPercent,
+                                   uint8_t skipReads)
+  : _regs(regs), _minCounts(minCounts), _highPercent(highPercent),
+    _skipReads(skipReads), _skip(0), _discarded(0), _changes(0) {
+}
+
+uint16_t TSL2591AutoRange::maxCount(tsl2591IntegrationTime_t timing) {
+  return (timing == TSL2591_INTEGRATIONTIME_100MS) ? TSL2591_MAX_COUNT_100MS : TSL2591_MAX_COUNT;
+}
+
+uint16_t TSL2591AutoRange::gainFactor(tsl2591Gain_t gain) {
+  switch (gain) {
+    case TSL2591_GAIN_LOW:
+      return 1;
+    case TSL2591_GAIN_MED:
+      return 25;
+    case TSL2591_GAIN_HIGH:
+      return 428;
+    case TSL2591_GAIN_MAX:
+      return 9876;
+  }
+  return 1;
+}
+
+uint16_t TSL2591AutoRange::highCount(tsl2591IntegrationTime_t timing) const {
+  return (uint32_t)maxCount(timing) * _highPercent / 100;
+}
+
+/**************************************************************************/
+/*
+    Blocks for one integration like getFullLuminosity(), samples taken
+    right after a range change are counted and dropped (valid false).
+    An I2C error is returned as such and leaves the range alone.
+*/
+/**************************************************************************/
+int TSL2591AutoRange::read(uint16_t &full, uint16_t &ir, bool &valid) {
+  valid = false;
+  // The settings in use, after a bus error they are read back first
+  int err = _regs.valid() ? 0 : _regs.resync();
+  uint32_t lum;
+  if (err == 0) {
+    err = _regs.readFullLuminosity(_regs.timing(), lum);
+  }
+  if (err) {
+    return err;
+  }
+  ir = lum >> 16;
+  full = lum & 0xFFFF;
+
+  if (_skip) {
+    _skip--;
+    _discarded++;
+    return 0;
+  }
+  if (update(full, ir)) {
+    _discarded++;
+    return 0;
+  }
+  valid = true;
+  return 0;
+}
+
+bool TSL2591AutoRange::update(uint16_t full, uint16_t ir) {
+  tsl2591Gain_t gain = _regs.gain();
+  tsl2591IntegrationTime_t timing = _regs.timing();
+  uint16_t high = highCount(timing);
+
+  if (full >= high || ir >= high) {
+    if (full >= maxCount(timing) || ir >= maxCount(timing)) {
+      // Clipped, the real level is unknown. Shortest timing first, then less gain
+      if (timing != TSL2591_INTEGRATIONTIME_100MS) {
+        apply(gain, TSL2591_INTEGRATIONTIME_100MS);
+        return true;
+      }
+      if (gain != TSL2591_GAIN_LOW) {
+        apply((tsl2591Gain_t)(gain - TSL2591_GAIN_MED), timing);
+        return true;
+      }
+      return false;
+    }
+  } else if (full >= _minCounts) {
+    return false;
+  }
+
+  // Rescale: counts are proportional to gain * integration time
+  uint32_t sens = (uint32_t)gainFactor(gain) * (timing + 1);
+  uint32_t counts = full ? full : 1;
+
+  for (int t = TSL2591_INTEGRATIONTIME_100MS; t <= TSL2591_INTEGRATIONTIME_600MS; t++) {
+    uint16_t limit = highCount((tsl2591IntegrationTime_t)t);
+    // Highest gain that stays below the limit gives the best resolution
+    for (int g = 3; g >= 0; g--) {
+      uint64_t predicted = (uint64_t)counts * gainFactor(gains[g]) * (t + 1) / sens;
+      if (predicted < limit && predicted >= _minCounts) {
+        if (gains[g] == gain && t == timing) {
+          return false;
+        }
+        apply(gains[g], (tsl2591IntegrationTime_t)t);
+        return true;
+      }
+    }
+  }
+
+  // Nothing fits: too dark for the window, use the most sensitive setting
+  if (full < _minCounts &&
+      (gain != TSL2591_GAIN_MAX || timing != TSL2591_INTEGRATIONTIME_600MS)) {
+    apply(TSL2591_GAIN_MAX, TSL2591_INTEGRATIONTIME_600MS);
+    return true;
+  }
+  return false;
+}
+
+void TSL2591AutoRange::apply(tsl2591Gain_t gain, tsl2591IntegrationTime_t timing) {
+  // Gain and timing in one CONTROL write. If it fails the shadow is
+  // dropped and the next read() picks up whatever the sensor has
+  _regs.setControl(gain, timing);
+  _skip = _skipReads;
+  _changes++;
+}
@@ -0,0 +1,64 @@
+/* TSL2591 Digital Light Sensor, automatic gain and integration time */
+
+#ifndef TSL2591_AUTO_RANGE_H
+#define TSL2591_AUTO_RANGE_H
+
+#include "mbed.h"
+#include "Adafruit_TSL2591.h"
+#include "TSL2591Registers.h"
+#include "TSL2591Sample.h"
+
+/**************************************************************************/
+/*
+    Replaces the fixed setGain()/setTiming() of configureSensor() with an
+    automatic range selection.
+
+    Every reading is checked against a window of CH0 counts: at least
+    minCounts (enough resolution) and at most highPercent of full scale
+    for the current integration time (linear range, margin for changes).
+    Outside the window the sensitivity is rescaled in one step to the
+    combination of gain and timing with the shortest integration time
+    whose predicted counts fit the window, instead of walking gain and
+    timing one notch at a time. A saturated reading carries no scale
+    information, so it first drops to 100 ms and then one gain step.
+
+    After a change skipReads conversions are thrown away, the number of
+    discarded samples is kept in discarded().
+
+    Gain and timing are read and changed through the register shadow
+    (TSL2591Registers::setControl()), regs.gain()/regs.timing() are the
+    settings in use. The cache of Adafruit_TSL2591 keeps what
+    configureSensor() set, don't convert with tsl.getGain()/getTiming().
+*/
+/**************************************************************************/
+class TSL2591AutoRange {
+public:
+  TSL2591AutoRange(TSL2591Registers &regs, uint16_t minCounts = 1000, uint8_t highPercent = 80,
+                   uint8_t skipReads = 1);
+
+  /* Reads the sensor, returns 0 or the I2C error. valid is false for a discarded sample */
+  int read(uint16_t &full, uint16_t &ir, bool &valid);
+
+  /* Looks at one raw sample and reconfigures the sensor, true on change */
+  bool update(uint16_t full, uint16_t ir);
+
+  uint32_t discarded(void) const { return _discarded; }
+  uint32_t changes(void) const { return _changes; }
+
+  static uint16_t maxCount(tsl2591IntegrationTime_t timing);
+  static uint16_t gainFactor(tsl2591Gain_t gain);
+
+private:
+  uint16_t highCount(tsl2591IntegrationTime_t timing) const;
+  void apply(tsl2591Gain_t gain, tsl2591IntegrationTime_t timing);
+
+  TSL2591Registers &_regs;
+  uint16_t _minCounts;
+  uint8_t _highPercent;
+  uint8_t _skipReads;
+  uint8_t _skip;
+  uint32_t _discarded;
+  uint32_t _changes;
+};
+
+#endif
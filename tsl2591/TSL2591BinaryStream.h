@@ -0,0 +1,80 @@
+/* TSL2591 Digital Light Sensor, binary framed sample output */
+
+#ifndef TSL2591_BINARY_STREAM_H
+#define TSL2591_BINARY_STREAM_H
+
+#include "mbed.h"
+#include "TSL2591Sample.h"
+
+/*
+    Frame layout, all fields little endian (18 bytes instead of ~50 for
+    the "IR: ... Lux: ..." text line):
+
+      0   2  sync 0xA5 0x5A
+      2   2  sequence number (gaps = lost frames)
+      4   4  timestamp [ms]
+      8   2  full spectrum (CH0)
+     10   2  infrared (CH1)
+     12   1  gain (tsl2591Gain_t)
+     13   1  timing (tsl2591IntegrationTime_t)
+     14   1  flags (TSL2591_SAMPLE_*)
+     15   1  retries
+     16   2  CRC-16/CCITT-FALSE over bytes 2..15
+
+    tools/tsl2591_decode.py decodes the stream on the host.
+*/
+#define TSL2591_FRAME_SYNC0 (0xA5)
+#define TSL2591_FRAME_SYNC1 (0x5A)
+#define TSL2591_FRAME_SIZE  (18)
+
+// Frames collected into one UART (DMA) transfer
+#ifndef TSL2591_STREAM_BATCH
+#define TSL2591_STREAM_BATCH (8)
+#endif
+
+/**************************************************************************/
+/*
+    Sends samples as fixed size binary frames without blocking the
+    caller. On targets with asynchronous serial the frames are collected
+    in two alternating buffers, one filled while the other is sent by the
+    UART (with DMA where the target has it). Otherwise a non-blocking
+    BufferedSerial is used. A frame that doesn't fit is dropped, the
+    sequence number still advances so the host sees the gap.
+*/
+/**************************************************************************/
+class TSL2591BinaryStream {
+public:
+  TSL2591BinaryStream(PinName tx, PinName rx, int baud = MBED_CONF_PLATFORM_STDIO_BAUD_RATE);
+
+  /* Queues one frame, returns false if it was dropped */
+  bool send(const TSL2591Sample &sample);
+
+  uint32_t dropped(void) const { return _dropped; }
+
+  static void encode(uint8_t *frame, uint16_t seq, const TSL2591Sample &sample);
+  static uint16_t crc16(const uint8_t *data, size_t len);
+
+private:
+#if DEVICE_SERIAL_ASYNCH
+  // SerialBase has the asynchronous write but no public constructor
+  class Uart : public SerialBase {
+  public:
+    Uart(PinName tx, PinName rx, int baud) : SerialBase(tx, rx, baud) {}
+  };
+
+  void kick(void);
+  void onTxDone(int event);
+
+  Uart _uart;
+  uint8_t _buf[2][TSL2591_STREAM_BATCH * TSL2591_FRAME_SIZE];
+  size_t _fill;
+  uint8_t _cur;
+  volatile bool _busy;
+#else
+  BufferedSerial _uart;
+#endif
+  uint16_t _seq;
+  uint32_t _dropped;
+};
+
+#endif
@@ -0,0 +1,171 @@
+/* TSL2591 Digital Light Sensor, block processing of buffered samples */
+
+#include "TSL2591Block.h"
+#include <math.h>
+
+void tsl2591Visible(const uint16_t *full, const uint16_t *ir, uint16_t *visible, size_t n) {
+  size_t i = 0;
+#if defined(__ARM_FEATURE_DSP) && __ARM_FEATURE_DSP
+  // Two lanes per word, only when all three arrays are word aligned
+  if ((((uintptr_t)full | (uintptr_t)ir | (uintptr_t)visible) & 3) == 0) {
+    const uint32_t *f = (const uint32_t *)full;
+    const uint32_t *r = (const uint32_t *)ir;
+    uint32_t *v = (uint32_t *)visible;
+    for (; i + 1 < n; i += 2) {
+      *v++ = __UQSUB16(*f++, *r++);
+    }
+  }
+#endif
+  for (; i < n; i++) {
+    visible[i] = full[i] > ir[i] ? full[i] - ir[i] : 0;
+  }
+}
+
+void tsl2591Deinterleave(const TSL2591Sample *samples, uint16_t *full, uint16_t *ir, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    full[i] = samples[i].full;
+    ir[i] = samples[i].ir;
+  }
+}
+
+float tsl2591Mean(const float *x, size_t n) {
+  if (n == 0) {
+    return 0.0F;
+  }
+  // Two accumulators, the adds of both pipelines don't wait on each other
+  float s0 = 0.0F, s1 = 0.0F;
+  size_t i = 0;
+  for (; i + 1 < n; i += 2) {
+    s0 += x[i];
+    s1 += x[i + 1];
+  }
+  if (i < n) {
+    s0 += x[i];
+  }
+  return (s0 + s1) / n;
+}
+
+TSL2591Biquad::TSL2591Biquad(void) : _stages(0), _primed(false) {
+  reset();
+}
+
+/**************************************************************************/
+/*
+    Bilinear transform of the analog Butterworth section (Q = 1/sqrt(2)),
+    several stages steepen the roll off
+*/
+/**************************************************************************/
+TSL2591Biquad TSL2591Biquad::lowpass(float cutoff, uint8_t stages) {
+  TSL2591Biquad biquad;
+  float k = tanf(3.14159265F * cutoff);
+  float norm = 1.0F / (1.0F + 1.41421356F * k + k * k);
+  float b0 = k * k * norm;
+  float coeffs[5] = {
+    b0, 2.0F * b0, b0,
+    -2.0F * (k * k - 1.0F) * norm,
+    -(1.0F - 1.41421356F * k + k * k) * norm
+  };
+  for (uint8_t i = 0; i < stages; i++) {
+    biquad.addStage(coeffs);
+  }
+  return biquad;
+}
+
+/**************************************************************************/
+/*
+    Band pass of the Audio EQ Cookbook (constant 0 dB peak gain), DC and
+    Nyquist are blocked completely
+*/
+/**************************************************************************/
+TSL2591Biquad TSL2591Biquad::bandpass(float center, float q) {
+  TSL2591Biquad biquad;
+  float w0 = 2.0F * 3.14159265F * center;
+  float alpha = sinf(w0) / (2.0F * q);
+  float norm = 1.0F / (1.0F + alpha);
+  float coeffs[5] = {
+    alpha * norm, 0.0F, -alpha * norm,
+    2.0F * cosf(w0) * norm,
+    -(1.0F - alpha) * norm
+  };
+  biquad.addStage(coeffs);
+  return biquad;
+}
+
+bool TSL2591Biquad::addStage(const float coeffs[5]) {
+  if (_stages >= TSL2591_BIQUAD_MAX_STAGES) {
+    return false;
+  }
+  memcpy(_coeffs[_stages], coeffs, sizeof(_coeffs[0]));
+  _stages++;
+  reset();
+  return true;
+}
+
+void TSL2591Biquad::reset(void) {
+  memset(_state, 0, sizeof(_state));
+  _primed = false;
+}
+
+void TSL2591Biquad::process(float *data, size_t n) {
+  if (n && !_primed) {
+    // Start in steady state at the first value instead of ramping up from 0
+    for (uint8_t s = 0; s < _stages; s++) {
+      const float *c = _coeffs[s];
+      float gain = (c[0] + c[1] + c[2]) / (1.0F - c[3] - c[4]);
+      float y = data[0] * gain;
+      _state[s][1] = c[2] * data[0] + c[4] * y;
+      _state[s][0] = c[1] * data[0] + c[3] * y + _state[s][1];
+    }
+    _primed = true;
+  }
+  for (uint8_t s = 0; s < _stages; s++) {
+    const float b0 = _coeffs[s][0], b1 = _coeffs[s][1], b2 = _coeffs[s][2];
+    const float a1 = _coeffs[s][3], a2 = _coeffs[s][4];
+    float d1 = _state[s][0], d2 = _state[s][1];
+    for (size_t i = 0; i < n; i++) {
+      float x = data[i];
+      float y = b0 * x + d1;
+      d1 = b1 * x + a1 * y + d2;
+      d2 = b2 * x + a2 * y;
+      data[i] = y;
+    }
+    _state[s][0] = d1;
+    _state[s][1] = d2;
+  }
+}
+
+size_t TSL2591Block::load(const TSL2591Sample *samples, size_t n) {
+  if (n > TSL2591_BLOCK_SIZE) {
+    n = TSL2591_BLOCK_SIZE;
+  }
+  tsl2591Deinterleave(samples, _full, _ir, n);
+  for (size_t i = 0; i < n; i++) {
+    _gain[i] = samples[i].gain;
+    _timing[i] = samples[i].timing;
+  }
+  if (n) {
+    _first = samples[0].timestamp;
+    _last = samples[n - 1].timestamp;
+  }
+  _count = n;
+  return n;
+}
+
+void TSL2591Block::convert(const TSL2591LuxTable &table) {
+  tsl2591Visible(_full, _ir, _visible, _count);
+  for (size_t i = 0; i < _count; i++) {
+    _lux[i] = TSL2591LuxTable::lux(_full[i], _ir[i], table.factor(_gain[i], _timing[i]));
+  }
+}
+
+void TSL2591Block::filter(TSL2591Biquad &biquad) {
+  for (size_t i = 0; i < _count; i++) {
+    if (_lux[i] < 0.0F) {
+      _filtered[i] = _hold;
+      _overflows++;
+    } else {
+      _filtered[i] = _hold = _lux[i];
+    }
+  }
+  biquad.process(_filtered, _count);
+}
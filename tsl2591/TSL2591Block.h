@@ -0,0 +1,125 @@
+/* TSL2591 Digital Light Sensor, block processing of buffered samples */
+
+#ifndef TSL2591_BLOCK_H
+#define TSL2591_BLOCK_H
+
+#include "mbed.h"
+#include "TSL2591Sample.h"
+#include "TSL2591LuxTable.h"
+
+#ifndef TSL2591_BLOCK_SIZE
+#define TSL2591_BLOCK_SIZE (32)
+#endif
+
+#ifndef TSL2591_BIQUAD_MAX_STAGES
+#define TSL2591_BIQUAD_MAX_STAGES (2)
+#endif
+
+/**************************************************************************/
+/*
+    visible[i] = full[i] - ir[i], clamped at 0 like a reading with IR
+    above full should be. On cores with the DSP extension two samples
+    are subtracted per instruction (__UQSUB16), the buffers may overlap
+    completely (visible == full) but need 4 byte alignment then.
+*/
+/**************************************************************************/
+void tsl2591Visible(const uint16_t *full, const uint16_t *ir, uint16_t *visible, size_t n);
+
+/* Splits n samples into separate full/ir arrays */
+void tsl2591Deinterleave(const TSL2591Sample *samples, uint16_t *full, uint16_t *ir, size_t n);
+
+float tsl2591Mean(const float *x, size_t n);
+
+/**************************************************************************/
+/*
+    Cascade of biquads, direct form II transposed, the same structure as
+    arm_biquad_cascade_df2T_f32(). Coefficients per stage are
+    { b0, b1, b2, a1, a2 } with a1/a2 negated, i.e.
+
+      y[n] = b0 x[n] + b1 x[n-1] + b2 x[n-2] + a1 y[n-1] + a2 y[n-2]
+
+    The state is kept between process() calls, so consecutive blocks are
+    filtered as one stream.
+*/
+/**************************************************************************/
+class TSL2591Biquad {
+public:
+  TSL2591Biquad(void);
+
+  /* Butterworth low pass, cutoff as a fraction of the sample rate (< 0.5) */
+  static TSL2591Biquad lowpass(float cutoff, uint8_t stages = 1);
+
+  /* Band pass with 0 dB at center (fraction of the sample rate), Q = center / bandwidth */
+  static TSL2591Biquad bandpass(float center, float q);
+
+  bool addStage(const float coeffs[5]);
+  void reset(void);
+
+  /* Filters n samples in place */
+  void process(float *data, size_t n);
+
+private:
+  float _coeffs[TSL2591_BIQUAD_MAX_STAGES][5];
+  float _state[TSL2591_BIQUAD_MAX_STAGES][2];
+  uint8_t _stages;
+  bool _primed;
+};
+
+/**************************************************************************/
+/*
+    Structure of arrays for up to TSL2591_BLOCK_SIZE samples. load()
+    copies straight out of a contiguous run of the ring buffer (see
+    TSL2591RingBuffer::readable()), everything after that runs on the
+    arrays:
+
+      TSL2591Sample *run;
+      uint32_t n = samples.readable(run);
+      n = block.load(run, n);
+      samples.consume(n);
+      block.convert(luxTable);
+      block.filter(lowpass);
+
+    Overflowed readings (lux -1) are held at the last valid value before
+    filtering, so a clipped sample doesn't ring through the filter.
+*/
+/**************************************************************************/
+class TSL2591Block {
+public:
+  TSL2591Block(void) : _count(0), _overflows(0), _hold(0) {}
+
+  /* Returns the number of samples taken over (at most TSL2591_BLOCK_SIZE) */
+  size_t load(const TSL2591Sample *samples, size_t n);
+
+  /* visible and lux for all samples, each with its own gain/timing */
+  void convert(const TSL2591LuxTable &table);
+
+  /* Low pass or any other cascade over lux, result in filtered() */
+  void filter(TSL2591Biquad &biquad);
+
+  size_t count(void) const { return _count; }
+  uint32_t overflows(void) const { return _overflows; }
+  uint32_t firstTimestamp(void) const { return _first; }
+  uint32_t lastTimestamp(void) const { return _last; }
+
+  const uint16_t *full(void) const { return _full; }
+  const uint16_t *ir(void) const { return _ir; }
+  const uint16_t *visible(void) const { return _visible; }
+  const float *lux(void) const { return _lux; }
+  const float *filtered(void) const { return _filtered; }
+
+private:
+  MBED_ALIGN(4) uint16_t _full[TSL2591_BLOCK_SIZE];
+  MBED_ALIGN(4) uint16_t _ir[TSL2591_BLOCK_SIZE];
+  MBED_ALIGN(4) uint16_t _visible[TSL2591_BLOCK_SIZE];
+  float _lux[TSL2591_BLOCK_SIZE];
+  float _filtered[TSL2591_BLOCK_SIZE];
+  uint8_t _gain[TSL2591_BLOCK_SIZE];
+  uint8_t _timing[TSL2591_BLOCK_SIZE];
+  size_t _count;
+  uint32_t _first;
+  uint32_t _last;
+  uint32_t _overflows;
+  float _hold;
+};
+
+#endif
@@ -0,0 +1,184 @@
+/* TSL2591 Digital Light Sensor, continuous back to back conversions */
+
+#include "TSL2591Continuous.h"
+
+#define CONVERSION_FLAG (1UL << 0)
+
+// Polling starts this long before the expected end of a conversion
+#define CONTINUOUS_POLL_LEAD_MS (5)
+#define CONTINUOUS_POLL_MS      (1)
+
+TSL2591Continuous::TSL2591Continuous(Adafruit_TSL2591 &tsl, TSL2591Registers &regs, InterruptIn *intPin,
+                                     osPriority priority)
+  : _tsl(tsl), _regs(regs), _int(intPin), _timing(TSL2591_INTEGRATIONTIME_100MS), _gain(TSL2591_GAIN_MED),
+    _fill(0), _read(0), _count(0), _ready(0), _thread(priority, sizeof(_stack), _stack, "tsl2591 cont") {
+  _held[0] = _held[1] = false;
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+std::chrono::milliseconds TSL2591Continuous::period(tsl2591IntegrationTime_t timing) {
+  return std::chrono::milliseconds(100 * (timing + 1));
+}
+
+/**************************************************************************/
+/*
+    Takes gain and timing from the shadow, what the sensor really runs
+    with: the setters of Adafruit_TSL2591 don't report failed writes
+    and a recovery writes CONTROL again. Without a valid shadow the
+    values stay, a transfer that succeeds after a recovery loads it.
+*/
+/**************************************************************************/
+void TSL2591Continuous::loadSettings(void) {
+  if (_regs.valid()) {
+    _gain = _regs.gain();
+    _timing = _regs.timing();
+  }
+}
+
+int TSL2591Continuous::start(void) {
+  _timing = _tsl.getTiming();
+  _gain = _tsl.getGain();
+  if (!_regs.valid()) {
+    _regs.resync();
+  }
+  loadSettings();
+
+  int err = _regs.setPersist(TSL2591_PERSIST_EVERY);
+  if (err == 0) {
+    err = _regs.command(TSL2591_CLEAR_INT);
+  }
+  if (err == 0) {
+    if (_int) {
+      _int->fall(callback(this, &TSL2591Continuous::onInterrupt));
+    }
+    // The ALS interrupt fires at the end of every cycle (PERSIST_EVERY)
+    err = _regs.write8(TSL2591_REGISTER_ENABLE,
+                       TSL2591_ENABLE_POWERON | TSL2591_ENABLE_AEN | TSL2591_ENABLE_AIEN);
+  }
+  if (err == 0) {
+    _thread.start(callback(this, &TSL2591Continuous::run));
+  }
+  return err;
+}
+
+void TSL2591Continuous::onInterrupt(void) {
+  _flags.set(CONVERSION_FLAG);
+}
+
+/**************************************************************************/
+/*
+    Blocks until the next conversion is complete, 0 on success
+*/
+/**************************************************************************/
+int TSL2591Continuous::waitConversion(Kernel::Clock::time_point expected) {
+  Kernel::Clock::time_point timeout = expected + period(_timing);
+
+  if (_int) {
+    Kernel::Clock::time_point now = Kernel::Clock::now();
+    Kernel::Clock::duration left = timeout > now ? timeout - now : Kernel::Clock::duration(0);
+    uint32_t flags = _flags.wait_any_for(CONVERSION_FLAG, left);
+    return (flags & osFlagsError) ? -1 : 0;
+  }
+
+  ThisThread::sleep_until(expected - std::chrono::milliseconds(CONTINUOUS_POLL_LEAD_MS));
+  while (true) {
+    uint8_t status;
+    int err = _regs.read8(TSL2591_REGISTER_DEVICE_STATUS, status);
+    if (err) {
+      return err;
+    }
+    if (status & TSL2591_STATUS_AINT) {
+      return 0;
+    }
+    if (Kernel::Clock::now() >= timeout) {
+      return -1;
+    }
+    ThisThread::sleep_for(std::chrono::milliseconds(CONTINUOUS_POLL_MS));
+  }
+}
+
+void TSL2591Continuous::run(void) {
+  Kernel::Clock::duration p = period(_timing);
+  Kernel::Clock::time_point last = Kernel::Clock::now();
+  bool first = true;
+
+  while (true) {
+    int err = waitConversion(last + p);
+    Kernel::Clock::time_point now = Kernel::Clock::now();
+
+    uint32_t lum = 0;
+    if (err == 0) {
+      // The data registers hold this result until the next cycle ends
+      err = _regs.readChannels(lum);
+    }
+    int clear = _regs.command(TSL2591_CLEAR_INT);
+
+    _statsMutex.lock();
+    if (err || clear) {
+      _stats.errors++;
+    } else {
+      _stats.samples++;
+      // More than 1.5 periods since the last one: conversions were lost
+      if (!first && now - last > p + p / 2) {
+        _stats.missed += (now - last + p / 2) / p - 1;
+      }
+    }
+    _statsMutex.unlock();
+
+    if (err) {
+      loadSettings();
+      p = period(_timing);
+      // Resynchronize on the next conversion, whenever it comes
+      last = Kernel::Clock::now() - p / 2;
+      continue;
+    }
+    first = false;
+    last = now;
+
+    TSL2591Sample sample = TSL2591Sample::make(lum & 0xFFFF, lum >> 16, _gain, _timing);
+    sample.timestamp = (uint32_t)now.time_since_epoch().count();
+    store(sample);
+  }
+}
+
+void TSL2591Continuous::store(const TSL2591Sample &sample) {
+  _frames[_fill][_count++] = sample;
+  if (_count < TSL2591_CONTINUOUS_FRAME) {
+    return;
+  }
+  _count = 0;
+  if (core_util_atomic_load_bool(&_held[_fill ^ 1])) {
+    // The consumer is still on the other frame, refill this one
+    _statsMutex.lock();
+    _stats.overruns++;
+    _statsMutex.unlock();
+    return;
+  }
+  core_util_atomic_store_bool(&_held[_fill], true);
+  _statsMutex.lock();
+  _stats.frames++;
+  _statsMutex.unlock();
+  _ready.release();
+  _fill ^= 1;
+}
+
+const TSL2591Sample *TSL2591Continuous::acquire(size_t &n, Kernel::Clock::duration_u32 timeout) {
+  if (!_ready.try_acquire_for(timeout)) {
+    n = 0;
+    return NULL;
+  }
+  n = TSL2591_CONTINUOUS_FRAME;
+  return _frames[_read];
+}
+
+void TSL2591Continuous::release(void) {
+  core_util_atomic_store_bool(&_held[_read], false);
+  _read ^= 1;
+}
+
+TSL2591ContinuousStats TSL2591Continuous::stats(void) {
+  _statsMutex.lock();
+  TSL2591ContinuousStats s = _stats;
+  _statsMutex.unlock();
+  return s;
+}
@@ -0,0 +1,102 @@
+/* TSL2591 Digital Light Sensor, continuous back to back conversions */
+
+#ifndef TSL2591_CONTINUOUS_H
+#define TSL2591_CONTINUOUS_H
+
+#include "mbed.h"
+#include "Adafruit_TSL2591.h"
+#include "TSL2591Registers.h"
+#include "TSL2591Sample.h"
+
+// Samples per frame, one frame fills while the consumer owns the other
+#ifndef TSL2591_CONTINUOUS_FRAME
+#define TSL2591_CONTINUOUS_FRAME (10)
+#endif
+
+#ifndef TSL2591_CONTINUOUS_STACK_SIZE
+#define TSL2591_CONTINUOUS_STACK_SIZE (1536)
+#endif
+
+struct TSL2591ContinuousStats {
+  uint32_t samples;
+  uint32_t frames;      // handed to the consumer
+  uint32_t overruns;    // frames dropped, the consumer still held the other one
+  uint32_t missed;      // conversions lost between two samples (from the timestamps)
+  uint32_t errors;      // I2C errors or no conversion within two periods
+};
+
+/**************************************************************************/
+/*
+    Streams every conversion of the sensor: the ALS stays enabled, the
+    sensor integrates back to back and each result is read while the
+    next integration runs, so there is no dead time between samples (10
+    samples/s at TSL2591_INTEGRATIONTIME_100MS).
+
+    The end of a conversion is detected with the ALS interrupt and
+    persist filter TSL2591_PERSIST_EVERY, either on the INT pin or, without
+    one, by polling AINT in STATUS around the expected end of the cycle
+    (AVALID can't be used, it stays set while AEN is on). The sensor's
+    oscillator sets the pace, not the MCU timer, so nothing drifts apart.
+
+    Samples are collected in two frames of TSL2591_CONTINUOUS_FRAME:
+
+      continuous.start();
+      while (true) {
+        size_t n;
+        const TSL2591Sample *frame = continuous.acquire(n);
+        ... analyse n samples ...
+        continuous.release();
+      }
+
+    The timestamp of a sample is when its conversion was detected (end
+    of the integration). If the consumer holds on to a frame until the
+    next one is full, the new frame is dropped (overruns). Gain and
+    timing of the samples come from the register shadow, loaded again
+    after a bus error, so they match the counts after a bus recovery too.
+*/
+/**************************************************************************/
+class TSL2591Continuous {
+public:
+  TSL2591Continuous(Adafruit_TSL2591 &tsl, TSL2591Registers &regs, InterruptIn *intPin = NULL,
+                    osPriority priority = osPriorityAboveNormal);
+
+  /* Enables the ALS with the current gain/timing and starts the thread */
+  int start(void);
+
+  /* Next full frame, NULL on timeout. Hand it back with release() */
+  const TSL2591Sample *acquire(size_t &n, Kernel::Clock::duration_u32 timeout = Kernel::wait_for_u32_forever);
+  void release(void);
+
+  TSL2591ContinuousStats stats(void);
+
+  /* Nominal time of one conversion */
+  static std::chrono::milliseconds period(tsl2591IntegrationTime_t timing);
+
+private:
+  void loadSettings(void);
+  int waitConversion(Kernel::Clock::time_point expected);
+  void onInterrupt(void);
+  void store(const TSL2591Sample &sample);
+  void run(void);
+
+  Adafruit_TSL2591 &_tsl;
+  TSL2591Registers &_regs;
+  InterruptIn *_int;
+  tsl2591IntegrationTime_t _timing;
+  tsl2591Gain_t _gain;
+
+  TSL2591Sample _frames[2][TSL2591_CONTINUOUS_FRAME];
+  volatile bool _held[2];
+  uint8_t _fill;
+  uint8_t _read;
+  size_t _count;
+
+  TSL2591ContinuousStats _stats;
+  Mutex _statsMutex;
+  EventFlags _flags;
+  Semaphore _ready;
+  MBED_ALIGN(8) unsigned char _stack[TSL2591_CONTINUOUS_STACK_SIZE];
+  Thread _thread;
+};
+
+#endif
@@ -0,0 +1,42 @@
+/* TSL2591 Digital Light Sensor, data ready interrupt */
+
+#include "TSL2591DataReady.h"
+
+#define DATA_READY_FLAG (1UL << 0)
+
+TSL2591DataReady::TSL2591DataReady(TSL2591Registers &regs, PinName intPin)
+  : _regs(regs), _int(intPin, PullUp), _timeouts(0) {
+}
+
+int TSL2591DataReady::attach(void) {
+  int err = _regs.setPersist(TSL2591_PERSIST_EVERY);
+  if (err) {
+    return err;
+  }
+  _int.fall(callback(this, &TSL2591DataReady::onInterrupt));
+  _regs.attachWait(callback(this, &TSL2591DataReady::wait));
+  return 0;
+}
+
+void TSL2591DataReady::onInterrupt(void) {
+  TSL2591_TRACE_POINT(TSL2591_TRACE_ISR_BEGIN, TSL2591_REGISTER_DEVICE_STATUS, 0);
+  _flags.set(DATA_READY_FLAG);
+  TSL2591_TRACE_POINT(TSL2591_TRACE_ISR_END, TSL2591_REGISTER_DEVICE_STATUS, 0);
+}
+
+int TSL2591DataReady::wait(tsl2591IntegrationTime_t timing) {
+  // readFullLuminosity() has just set PON | AEN, add the interrupt enable
+  _flags.clear(DATA_READY_FLAG);
+  int err = _regs.write8(TSL2591_REGISTER_ENABLE,
+                         TSL2591_ENABLE_POWERON | TSL2591_ENABLE_AEN | TSL2591_ENABLE_AIEN);
+  if (err) {
+    return err;
+  }
+  uint32_t flags = _flags.wait_any_for(DATA_READY_FLAG, TSL2591Registers::conversionTime(timing));
+  err = _regs.command(TSL2591_CLEAR_INT);
+  if (flags & osFlagsError) {
+    _timeouts++;
+    return -1;
+  }
+  return err;
+}
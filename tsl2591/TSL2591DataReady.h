@@ -0,0 +1,49 @@
+/* TSL2591 Digital Light Sensor, data ready interrupt */
+
+#ifndef TSL2591_DATA_READY_H
+#define TSL2591_DATA_READY_H
+
+#include "mbed.h"
+#include "Adafruit_TSL2591.h"
+#include "TSL2591Registers.h"
+
+/**************************************************************************/
+/*
+    Wait handler for TSL2591Registers::readFullLuminosity() driven by the
+    INT pin: the persist filter is set to TSL2591_PERSIST_EVERY and AIEN
+    enabled, so the sensor pulls INT low at the end of every ALS cycle
+    and the reading starts right then instead of after the worst case
+    conversionTime(). The calling thread sleeps on an EventFlags in
+    between, no polling traffic on the bus.
+
+      TSL2591DataReady ready(regs, D2);
+      ready.attach();
+      regs.readFullLuminosity(timing, lum);
+
+    INT is open drain, active low. The interrupt is cleared before the
+    data is read, the ALS thresholds don't matter with PERSIST_EVERY.
+    Falls back to a timeout of conversionTime() if the edge never comes.
+*/
+/**************************************************************************/
+class TSL2591DataReady {
+public:
+  TSL2591DataReady(TSL2591Registers &regs, PinName intPin);
+
+  /* Configures the persist filter and installs wait() in the registers */
+  int attach(void);
+
+  /* Returns 0 once the conversion is done, -1 on timeout */
+  int wait(tsl2591IntegrationTime_t timing);
+
+  uint32_t timeouts(void) const { return _timeouts; }
+
+private:
+  void onInterrupt(void);
+
+  TSL2591Registers &_regs;
+  InterruptIn _int;
+  EventFlags _flags;
+  uint32_t _timeouts;
+};
+
+#endif
@@ -0,0 +1,69 @@
+/* TSL2591 Digital Light Sensor, duty cycled low power acquisition */
+
+#include "TSL2591DutyCycle.h"
+
+TSL2591DutyCycle::TSL2591DutyCycle(Adafruit_TSL2591 &tsl, TSL2591Registers &regs,
+                                   Kernel::Clock::duration period, const TSL2591PowerModel &model)
+  : _tsl(tsl), _regs(regs), _period(period), _next(Kernel::Clock::now()), _model(model),
+    _samples(0), _sensorActiveUs(0) {
+  memset(&_last, 0, sizeof(_last));
+#if MBED_CPU_STATS_ENABLED
+  mbed_stats_cpu_get(&_last);
+#endif
+}
+
+int TSL2591DutyCycle::sample(uint32_t &lum) {
+  // Start the integration so that the result is ready at the deadline
+  tsl2591IntegrationTime_t timing = _tsl.getTiming();
+  Kernel::Clock::duration conversion = TSL2591Registers::conversionTime(timing);
+
+  _next += _period;
+  Kernel::Clock::time_point start = _next - conversion;
+  if (start > Kernel::Clock::now()) {
+    ThisThread::sleep_until(start);
+  } else {
+    // Overrun, resynchronize instead of trying to catch up
+    _next = Kernel::Clock::now() + conversion;
+  }
+
+  Kernel::Clock::time_point on = Kernel::Clock::now();
+  int err = _regs.readFullLuminosity(timing, lum);
+  _sensorActiveUs += std::chrono::duration_cast<std::chrono::microseconds>(Kernel::Clock::now() - on).count();
+  if (err == 0) {
+    _samples++;
+  }
+  return err;
+}
+
+TSL2591EnergyReport TSL2591DutyCycle::report(void) {
+  TSL2591EnergyReport r;
+  memset(&r, 0, sizeof(r));
+  r.samples = _samples;
+  r.sensorActiveUs = _sensorActiveUs;
+  r.deepSleepLocked = !sleep_manager_can_deep_sleep();
+
+#if MBED_CPU_STATS_ENABLED
+  mbed_stats_cpu_t now;
+  mbed_stats_cpu_get(&now);
+  r.totalUs = now.uptime - _last.uptime;
+  r.sleepUs = now.sleep_time - _last.sleep_time;
+  r.deepSleepUs = now.deep_sleep_time - _last.deep_sleep_time;
+  r.runUs = r.totalUs - r.sleepUs - r.deepSleepUs;
+  _last = now;
+#endif
+
+  if (r.samples) {
+    uint64_t sensorStandbyUs = (r.totalUs > r.sensorActiveUs) ? r.totalUs - r.sensorActiveUs : 0;
+    // uA * us = pC, times mV gives 1e-9 uJ
+    uint64_t charge = (uint64_t)_model.mcuRunUa * r.runUs +
+                      (uint64_t)_model.mcuSleepUa * r.sleepUs +
+                      (uint64_t)_model.mcuDeepSleepUa * r.deepSleepUs +
+                      (uint64_t)_model.sensorActiveUa * r.sensorActiveUs +
+                      (uint64_t)_model.sensorStandbyUa * sensorStandbyUs;
+    r.energyPerSampleUj = (charge / 1000000) * _model.supplyMv / 1000 / r.samples;
+  }
+
+  _samples = 0;
+  _sensorActiveUs = 0;
+  return r;
+}
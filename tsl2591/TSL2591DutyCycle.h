@@ -0,0 +1,76 @@
+/* TSL2591 Digital Light Sensor, duty cycled low power acquisition */
+
+#ifndef TSL2591_DUTY_CYCLE_H
+#define TSL2591_DUTY_CYCLE_H
+
+#include "mbed.h"
+#include "Adafruit_TSL2591.h"
+#include "TSL2591Registers.h"
+
+/**************************************************************************/
+/*
+    Currents [uA] and supply voltage [mV] the energy estimate is based
+    on. The defaults are rough NUCLEO_F767ZI figures (run at 216 MHz,
+    sleep, stop mode) and the TSL2591 datasheet values, measure your own
+    board and pass them in.
+*/
+/**************************************************************************/
+struct TSL2591PowerModel {
+  uint32_t mcuRunUa;
+  uint32_t mcuSleepUa;
+  uint32_t mcuDeepSleepUa;
+  uint32_t sensorActiveUa;
+  uint32_t sensorStandbyUa;
+  uint32_t supplyMv;
+};
+
+#define TSL2591_POWER_MODEL_DEFAULT { 110000, 50000, 300, 275, 2, 3300 }
+
+struct TSL2591EnergyReport {
+  uint32_t samples;
+  uint64_t runUs;             // MCU running
+  uint64_t sleepUs;           // MCU in sleep
+  uint64_t deepSleepUs;       // MCU in deep sleep
+  uint64_t sensorActiveUs;    // ALS enabled
+  uint64_t totalUs;
+  uint32_t energyPerSampleUj;
+  bool deepSleepLocked;       // someone holds a deep sleep lock right now
+};
+
+/**************************************************************************/
+/*
+    Low power acquisition: the sensor is powered up for exactly one
+    integration per sample, read with the channel burst read and powered
+    down again right away (2.3 uA standby instead of ~275 uA). Samples
+    are taken on absolute deadlines, in between the thread sleeps and,
+    as long as nobody holds a deep sleep lock, the sleep manager enters
+    deep sleep. Don't keep a Timer running, it locks deep sleep.
+
+    The time spent in each MCU state comes from mbed_stats_cpu_get()
+    (set platform.cpu-stats-enabled), the sensor on time is measured
+    here. Together with the power model this gives the energy per sample.
+*/
+/**************************************************************************/
+class TSL2591DutyCycle {
+public:
+  TSL2591DutyCycle(Adafruit_TSL2591 &tsl, TSL2591Registers &regs, Kernel::Clock::duration period,
+                   const TSL2591PowerModel &model = TSL2591_POWER_MODEL_DEFAULT);
+
+  /* Sleeps until the next sample is due, then takes it */
+  int sample(uint32_t &lum);
+
+  /* Energy since the last call (or since construction) */
+  TSL2591EnergyReport report(void);
+
+private:
+  Adafruit_TSL2591 &_tsl;
+  TSL2591Registers &_regs;
+  Kernel::Clock::duration _period;
+  Kernel::Clock::time_point _next;
+  TSL2591PowerModel _model;
+  uint32_t _samples;
+  uint64_t _sensorActiveUs;
+  mbed_stats_cpu_t _last;
+};
+
+#endif
@@ -0,0 +1,148 @@
+/* TSL2591 Digital Light Sensor, IR ratio and flicker features */
+
+#include "TSL2591Features.h"
+#include <math.h>
+
+MBED_STATIC_ASSERT(sizeof(TSL2591FeatureVector) == TSL2591_FEATURES_SIZE, "TSL2591FeatureVector must stay 32 bytes");
+
+// Octave bands, Q = sqrt(2) is one octave between the -3 dB points
+static const float bandCenters[TSL2591_FEATURES_BANDS] = { 0.05F, 0.1F, 0.2F, 0.4F };
+#define BAND_Q (1.41421356F)
+
+static uint16_t q16(float x) {
+  if (!(x > 0.0F)) {
+    return 0;
+  }
+  return (x >= 1.0F) ? 0xFFFF : (uint16_t)(x * 65535.0F + 0.5F);
+}
+
+static void put16(uint8_t *p, uint16_t v) {
+  p[0] = v & 0xFF;
+  p[1] = v >> 8;
+}
+
+TSL2591Features::TSL2591Features(void)
+  : _count(0), _saturated(0), _last(0), _gain(0), _timing(0),
+    _haveLast(false), _bandSamples(0), _bandsValid(true) {
+  _full.reset();
+  _ratio.reset();
+  memset(_histogram, 0, sizeof(_histogram));
+  memset(_energy, 0, sizeof(_energy));
+  for (int b = 0; b < TSL2591_FEATURES_BANDS; b++) {
+    _bands[b] = TSL2591Biquad::bandpass(bandCenters[b], BAND_Q);
+  }
+}
+
+/**************************************************************************/
+/*
+    Starts the band filters over at the next sample. At the first sample
+    of a window that costs nothing, later on the window loses its band
+    values.
+*/
+/**************************************************************************/
+void TSL2591Features::restartBands(void) {
+  for (int b = 0; b < TSL2591_FEATURES_BANDS; b++) {
+    _bands[b].reset();
+  }
+  if (_count > 1) {
+    _bandsValid = false;
+  }
+}
+
+void TSL2591Features::add(const TSL2591Sample &s) {
+  // Back to back: same settings and the next conversion, not one later
+  uint32_t period = 100 * ((uint32_t)s.timing + 1);
+  bool contiguous = _haveLast && s.gain == _gain && s.timing == _timing &&
+                    (uint32_t)(s.timestamp - _last) <= period + period / 2;
+  _last = s.timestamp;
+  _gain = s.gain;
+  _timing = s.timing;
+  _haveLast = true;
+  _count++;
+
+  if (s.flags & TSL2591_SAMPLE_SATURATED) {
+    _saturated++;
+    _haveLast = false;
+    if (_count > 1) {
+      _bandsValid = false;
+    }
+    return;
+  }
+  if (!contiguous) {
+    restartBands();
+  }
+
+  _full.add(s.full);
+  float x = s.full;
+  for (int b = 0; b < TSL2591_FEATURES_BANDS; b++) {
+    float y = x;
+    _bands[b].process(&y, 1);
+    _energy[b] += y * y;
+  }
+  _bandSamples++;
+
+  if (s.full == 0) {
+    // Dark, there is no ratio
+    return;
+  }
+  float r = (float)s.ir / (float)s.full;
+  _ratio.add(r);
+  int bin = (int)(r * TSL2591_FEATURES_RATIO_BINS);
+  _histogram[bin < TSL2591_FEATURES_RATIO_BINS ? bin : TSL2591_FEATURES_RATIO_BINS - 1]++;
+}
+
+TSL2591FeatureVector TSL2591Features::flush(void) {
+  TSL2591FeatureVector v;
+  memset(&v, 0, sizeof(v));
+  v.timestamp = _last;
+  v.count = (_count < 0xFFFF) ? _count : 0xFFFF;
+  v.saturated = (_saturated < 0xFF) ? _saturated : 0xFF;
+  v.gain = _gain;
+  v.timing = _timing;
+  v.fullMean = (uint16_t)(_full.mean + 0.5F);
+
+  if (_ratio.n) {
+    v.flags |= TSL2591_FEATURES_RATIO_VALID;
+    v.ratioMean = q16(_ratio.mean);
+    v.ratioStddev = q16(_ratio.stddev());
+    for (int i = 0; i < TSL2591_FEATURES_RATIO_BINS; i++) {
+      v.histogram[i] = (uint8_t)((_histogram[i] * 255UL + _ratio.n / 2) / _ratio.n);
+    }
+  }
+  if (_bandsValid && _bandSamples >= TSL2591_FEATURES_MIN_BAND_SAMPLES && _full.mean > 0.0F) {
+    v.flags |= TSL2591_FEATURES_BANDS_VALID;
+    for (int b = 0; b < TSL2591_FEATURES_BANDS; b++) {
+      v.band[b] = q16(sqrtf(_energy[b] / _bandSamples) / _full.mean);
+    }
+  }
+
+  // Next window, the filters run on
+  _count = 0;
+  _saturated = 0;
+  _full.reset();
+  _ratio.reset();
+  memset(_histogram, 0, sizeof(_histogram));
+  memset(_energy, 0, sizeof(_energy));
+  _bandSamples = 0;
+  _bandsValid = true;
+  return v;
+}
+
+void TSL2591Features::encode(uint8_t *out, const TSL2591FeatureVector &v) {
+  out[0] = v.timestamp & 0xFF;
+  out[1] = (v.timestamp >> 8) & 0xFF;
+  out[2] = (v.timestamp >> 16) & 0xFF;
+  out[3] = v.timestamp >> 24;
+  put16(&out[4], v.count);
+  out[6] = v.saturated;
+  out[7] = v.flags;
+  out[8] = v.gain;
+  out[9] = v.timing;
+  put16(&out[10], v.fullMean);
+  put16(&out[12], v.ratioMean);
+  put16(&out[14], v.ratioStddev);
+  memcpy(&out[16], v.histogram, TSL2591_FEATURES_RATIO_BINS);
+  for (int b = 0; b < TSL2591_FEATURES_BANDS; b++) {
+    put16(&out[24 + 2 * b], v.band[b]);
+  }
+}
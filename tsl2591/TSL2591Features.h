@@ -0,0 +1,104 @@
+/* TSL2591 Digital Light Sensor, IR ratio and flicker features */
+
+#ifndef TSL2591_FEATURES_H
+#define TSL2591_FEATURES_H
+
+#include "mbed.h"
+#include "TSL2591Sample.h"
+#include "TSL2591Stats.h"
+#include "TSL2591Block.h"
+
+// IR / full histogram, linear bins from 0 to 1 (a ratio above 1 goes to the last one)
+#define TSL2591_FEATURES_RATIO_BINS (8)
+
+// Flicker bands, centers in fractions of the sample rate (octaves)
+#define TSL2591_FEATURES_BANDS      (4)
+
+// Back to back samples a window needs for the band values
+#ifndef TSL2591_FEATURES_MIN_BAND_SAMPLES
+#define TSL2591_FEATURES_MIN_BAND_SAMPLES (16)
+#endif
+
+// TSL2591FeatureVector::flags
+#define TSL2591_FEATURES_RATIO_VALID (0x01)   // ratio fields valid (not only dark or clipped samples)
+#define TSL2591_FEATURES_BANDS_VALID (0x02)   // band fields valid (gapless window, one gain/timing)
+
+#define TSL2591_FEATURES_SIZE        (32)
+
+/**************************************************************************/
+/*
+    One window in 32 bytes, fixed point so it can be sent as is (see
+    TSL2591Features::encode() for the byte order). Ratios are Q0.16
+    (65535 = 1), band values the RMS of CH0 in the band relative to the
+    CH0 mean, also Q0.16.
+*/
+/**************************************************************************/
+struct TSL2591FeatureVector {
+  uint32_t timestamp;     // last sample of the window [ms]
+  uint16_t count;         // samples in the window
+  uint8_t saturated;      // of them clipped, left out of everything below (up to 255)
+  uint8_t flags;          // TSL2591_FEATURES_*
+  uint8_t gain;           // of the last sample (tsl2591Gain_t)
+  uint8_t timing;         // tsl2591IntegrationTime_t
+  uint16_t fullMean;      // CH0
+  uint16_t ratioMean;     // IR / full
+  uint16_t ratioStddev;
+  uint8_t histogram[TSL2591_FEATURES_RATIO_BINS];   // share of the ratios per bin, 255 = all
+  uint16_t band[TSL2591_FEATURES_BANDS];
+};
+
+/**************************************************************************/
+/*
+    Features for telling light sources apart, computed sample by sample
+    in constant memory like TSL2591Stats. add() every sample, flush()
+    at the end of a window returns its vector and starts the next one.
+
+    The IR ratio (CH1 / CH0) separates the sources: LEDs and fluorescent
+    tubes are near 0.1 and below, daylight in between and incandescent
+    or halogen light above 0.5. The histogram shows whether the window
+    saw one source or a mix.
+
+    The flicker bands are band passes over the CH0 sequence centered at
+    1/20, 1/10, 1/5 and 2/5 of the sample rate (0.5, 1, 2 and 4 Hz with
+    the 100 ms conversions of TSL2591Continuous). They only mean
+    something on evenly spaced samples, that is in continuous mode: a gap
+    of more than half a period, a gain/timing change or a clipped sample
+    restarts the filters and the window has no band values. Mains
+    flicker itself (100/120 Hz) is averaged out by the integration, what
+    the bands see is its beat against the integration time and slower
+    modulation such as dimmers and PWM drivers.
+*/
+/**************************************************************************/
+class TSL2591Features {
+public:
+  TSL2591Features(void);
+
+  void add(const TSL2591Sample &s);
+
+  uint32_t count(void) const { return _count; }
+
+  TSL2591FeatureVector flush(void);
+
+  /* Little endian, TSL2591_FEATURES_SIZE bytes */
+  static void encode(uint8_t *out, const TSL2591FeatureVector &v);
+
+private:
+  void restartBands(void);
+
+  uint32_t _count;
+  uint32_t _saturated;
+  uint32_t _last;
+  uint8_t _gain;
+  uint8_t _timing;
+  bool _haveLast;
+  TSL2591RunningStat _full;
+  TSL2591RunningStat _ratio;
+  uint16_t _histogram[TSL2591_FEATURES_RATIO_BINS];
+
+  TSL2591Biquad _bands[TSL2591_FEATURES_BANDS];
+  float _energy[TSL2591_FEATURES_BANDS];
+  uint32_t _bandSamples;
+  bool _bandsValid;     // no restart in this window
+};
+
+#endif
@@ -0,0 +1,86 @@
+/* TSL2591 Digital Light Sensor, compile time sensor configuration */
+
+#ifndef TSL2591_FIXED_CONFIG_H
+#define TSL2591_FIXED_CONFIG_H
+
+#include "mbed.h"
+#include "Adafruit_TSL2591.h"
+#include "TSL2591FixedLux.h"
+
+/**************************************************************************/
+/*
+    Gain and integration time fixed at compile time, for production
+    builds that never change them. Everything calculateLux() derives per
+    call (gain multiplier, atime, CPL) is a compile time constant here,
+    the lux conversion is a handful of multiplies and one division:
+
+      typedef TSL2591FixedConfig<TSL2591_GAIN_MED, TSL2591_INTEGRATIONTIME_300MS> Config;
+
+      Config::apply(tsl);                      // once, after begin()
+      float lux = Config::lux(full, ir);       // == tsl.calculateLux(full, ir)
+      uint32_t mlux = Config::milliLux(full, ir);
+*/
+/**************************************************************************/
+template <tsl2591Gain_t Gain, tsl2591IntegrationTime_t Timing>
+struct TSL2591FixedConfig {
+  static constexpr tsl2591Gain_t gain(void) { return Gain; }
+  static constexpr tsl2591IntegrationTime_t timing(void) { return Timing; }
+
+  /* Same multipliers as calculateLux() */
+  static constexpr uint32_t again(void) {
+    return (Gain == TSL2591_GAIN_LOW)  ? 1 :
+           (Gain == TSL2591_GAIN_MED)  ? 25 :
+           (Gain == TSL2591_GAIN_HIGH) ? 428 : 9876;
+  }
+
+  static constexpr uint32_t atime(void) { return 100 * ((uint32_t)Timing + 1); }
+
+  /* 1 / CPL, calculateLux() divides by CPL = (atime * again) / LUX_DF */
+  static constexpr float luxPerCount(void) { return TSL2591_LUX_DF / (float)(atime() * again()); }
+
+  /* Full scale count of the ADCs at this integration time */
+  static constexpr uint16_t maxCount(void) { return (Timing == TSL2591_INTEGRATIONTIME_100MS) ? 0x8FFF : 0xFFFF; }
+
+  static constexpr const char *gainName(void) {
+    return (Gain == TSL2591_GAIN_LOW)  ? "1x (Low)" :
+           (Gain == TSL2591_GAIN_MED)  ? "25x (Medium)" :
+           (Gain == TSL2591_GAIN_HIGH) ? "428x (High)" : "9876x (Max)";
+  }
+
+  static void apply(Adafruit_TSL2591 &tsl) {
+    tsl.setGain(Gain);
+    tsl.setTiming(Timing);
+  }
+
+  /*
+      calculateLux() with constant folding: (ch0 - ch1) * (1 - ch1 / ch0)
+      is (ch0 - ch1)^2 / ch0. Returns -1 on overflow like calculateLux(),
+      0 for ch0 == 0 like TSL2591LuxTable::lux().
+  */
+  static float lux(uint16_t ch0, uint16_t ch1) {
+    float d = (float)ch0 - (float)ch1;
+    float l = d * d / (ch0 ? (float)ch0 : 1.0F) * luxPerCount();
+    l = ch0 ? l : 0.0F;
+    return ((ch0 == 0xFFFF) | (ch1 == 0xFFFF)) ? -1.0F : l;
+  }
+
+  /*
+      Same result as tsl2591MilliLux() (floor(floor(n / a) / b) equals
+      floor(n / (a * b))), the second division is by a constant. Clamped
+      one below TSL2591_MILLILUX_OVERFLOW the same way.
+  */
+  static uint32_t milliLux(uint16_t ch0, uint16_t ch1) {
+    if ((ch0 == 0xFFFF) || (ch1 == 0xFFFF)) {
+      return TSL2591_MILLILUX_OVERFLOW;
+    }
+    if (ch0 == 0) {
+      return 0;
+    }
+    uint32_t d = (ch0 > ch1) ? ch0 - ch1 : ch1 - ch0;
+    uint64_t q = ((uint64_t)(d * d) * 408000ULL) / ch0;
+    uint64_t mlux = q / (atime() * again());
+    return (mlux < TSL2591_MILLILUX_OVERFLOW) ? (uint32_t)mlux : TSL2591_MILLILUX_OVERFLOW - 1;
+  }
+};
+
+#endif
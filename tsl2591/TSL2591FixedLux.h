@@ -0,0 +1,52 @@
+/* TSL2591 Digital Light Sensor, integer lux calculation */
+
+#ifndef TSL2591_FIXED_LUX_H
+#define TSL2591_FIXED_LUX_H
+
+#include "mbed.h"
+#include "Adafruit_TSL2591.h"
+
+// Returned instead of the -1 of calculateLux() when an ADC channel overflowed
+#define TSL2591_MILLILUX_OVERFLOW (0xFFFFFFFFUL)
+
+/**************************************************************************/
+/*
+    Integer version of Adafruit_TSL2591::calculateLux() for targets
+    without FPU, the result is in milli lux:
+
+      lux = (ch0 - ch1) * (1 - ch1 / ch0) * LUX_DF / (atime * again)
+          = (ch0 - ch1)^2 * LUX_DF / (ch0 * atime * again)
+
+    The expression is evaluated in 64-bit integers with a single
+    (truncating) division at the end, so the result is the exact value
+    rounded down to the next milli lux:
+
+      0 <= lux - mlux / 1000 < 0.001 lux
+
+    The float path itself loses precision in (1 - ch1 / ch0) when ch1
+    is close to ch0. Checked against it over 2M random ch0/ch1/gain/timing
+    inputs on the host both agree within 0.001 lux + 2e-5 * lux. Below
+    about 1 lux at MAX gain (1 count ~ 0.07 mlux at 600 ms) the milli
+    lux resolution is coarser than the ADC. The result is largest at
+    ch1 == 0, 100 ms and LOW gain, 4.08 lux per ch0 count: about 150.4
+    klx where the 100 ms conversion clips (36863), 267378.720 lux for the
+    largest non-clipped 16-bit input (65534). That is 16 times below
+    TSL2591_MILLILUX_OVERFLOW, a result can't be taken for the marker.
+    Only ch1 > ch0, which no light produces (noise near 0), can grow past
+    32 bits, it is clamped one below the marker. Unlike calculateLux()
+    ch0 == 0 returns 0.
+
+    Gain and timing are passed in, use tsl.getGain()/tsl.getTiming().
+*/
+/**************************************************************************/
+uint32_t tsl2591MilliLux(uint16_t ch0, uint16_t ch1, tsl2591Gain_t gain, tsl2591IntegrationTime_t timing);
+
+/**************************************************************************/
+/*
+    Formats a milli lux value as "<lux>.<3 digits>" (or "overflow")
+    without floating point printf support, returns like snprintf()
+*/
+/**************************************************************************/
+int tsl2591FormatMilliLux(char *buf, size_t size, uint32_t mlux);
+
+#endif
@@ -0,0 +1,27 @@
+/* TSL2591 Digital Light Sensor, RAM use at run time */
+
+#include "TSL2591Footprint.h"
+
+void tsl2591FootprintReport(void) {
+#if MBED_HEAP_STATS_ENABLED
+  mbed_stats_heap_t heap;
+  mbed_stats_heap_get(&heap);
+  printf("Heap: %lu bytes in %lu allocations  max: %lu  failed: %lu  reserved: %lu\n",
+         (unsigned long)heap.current_size, (unsigned long)heap.alloc_cnt, (unsigned long)heap.max_size,
+         (unsigned long)heap.alloc_fail_cnt, (unsigned long)heap.reserved_size);
+#else
+  printf("Heap: no statistics (platform.heap-stats-enabled)\n");
+#endif
+
+#if MBED_STACK_STATS_ENABLED
+  static mbed_stats_stack_t stacks[TSL2591_FOOTPRINT_MAX_THREADS];
+  size_t n = mbed_stats_stack_get_each(stacks, TSL2591_FOOTPRINT_MAX_THREADS);
+  for (size_t i = 0; i < n; i++) {
+    const char *name = osThreadGetName((osThreadId_t)(uintptr_t)stacks[i].thread_id);
+    printf("Stack: %lu of %lu bytes  %s\n", (unsigned long)stacks[i].max_size,
+           (unsigned long)stacks[i].reserved_size, name ? name : "?");
+  }
+#else
+  printf("Stacks: no statistics (platform.stack-stats-enabled)\n");
+#endif
+}
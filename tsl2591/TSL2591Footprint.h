@@ -0,0 +1,39 @@
+/* TSL2591 Digital Light Sensor, RAM use at run time */
+
+#ifndef TSL2591_FOOTPRINT_H
+#define TSL2591_FOOTPRINT_H
+
+#include "mbed.h"
+
+// Threads listed by the stack report
+#ifndef TSL2591_FOOTPRINT_MAX_THREADS
+#define TSL2591_FOOTPRINT_MAX_THREADS (8)
+#endif
+
+/**************************************************************************/
+/*
+    Prints what the heap and the thread stacks really use, the run time
+    half of the budget (tools/tsl2591_size.py reports flash and static
+    RAM per component from the map file).
+
+    The drivers and examples allocate everything statically: objects are
+    globals, thread stacks and event queue buffers are arrays, and the
+    RTOS objects keep their control blocks inside. A heap that is still
+    empty after startup (0 allocations) shows nothing else pulled one in.
+    The numbers need platform.heap-stats-enabled and
+    platform.stack-stats-enabled, without them the lines say so.
+
+    The minimal footprint profile mbed_app_minimal.json sets both and
+    builds with minimal-printf without float and 64-bit support and the
+    small (nano) C library, with fixed-point-lux for the lux values:
+
+      mbed compile -m NUCLEO_F767ZI -t GCC_ARM --app-config mbed_app_minimal.json
+      tools/tsl2591_size.py BUILD/NUCLEO_F767ZI/GCC_ARM/tsl2591.map
+
+    minimal-printf has no field widths and no float, keep the options
+    that print them (stats-window, block-filter, trace) off in it.
+*/
+/**************************************************************************/
+void tsl2591FootprintReport(void);
+
+#endif
@@ -0,0 +1,226 @@
+/* TSL2591 Digital Light Sensor, block buffered sample log */
+
+#include "TSL2591Logger.h"
+
+MBED_STATIC_ASSERT(sizeof(TSL2591LogHeader) == 16, "log header layout");
+MBED_STATIC_ASSERT(sizeof(TSL2591LogBlock) == TSL2591_LOG_BLOCK_SIZE, "log block layout");
+
+TSL2591Logger::TSL2591Logger(BlockDevice &bd, bd_addr_t start, bd_size_t size, osPriority priority)
+  : _bd(bd), _start(start), _size(size), _blocks(0), _next(0), _seq(0), _eraseSize(0), _erase(false),
+    _dirty(false), _unitRecords(0), _fill(0), _count(0), _lost(0), _flush(0), _thread(priority, sizeof(_stack), _stack, "tsl2591 log") {
+  _pending[0] = _pending[1] = false;
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+int TSL2591Logger::init(void) {
+  int err = _bd.init();
+  if (err) {
+    return err;
+  }
+  if (TSL2591_LOG_BLOCK_SIZE % _bd.get_program_size() || TSL2591_LOG_BLOCK_SIZE % _bd.get_read_size()) {
+    return BD_ERROR_DEVICE_ERROR;
+  }
+
+  // SD cards don't need an erase before programming, flash does
+  _erase = _bd.get_erase_value() != -1;
+  _eraseSize = _bd.get_erase_size();
+  if (_eraseSize < TSL2591_LOG_BLOCK_SIZE) {
+    _eraseSize = TSL2591_LOG_BLOCK_SIZE;
+  }
+  if (_size == 0) {
+    _size = _bd.size() - _start;
+  }
+  _size -= _size % _eraseSize;
+  if (_start % _eraseSize || _size < 2 * _eraseSize) {
+    return BD_ERROR_DEVICE_ERROR;
+  }
+  _blocks = _size / TSL2591_LOG_BLOCK_SIZE;
+
+  // Resume point. Blocks of the current round carry seq0 + index, so the
+  // ones after the write position (older round, erased or torn) don't
+  TSL2591LogHeader h;
+  if (readHeader(0, h)) {
+    uint32_t seq0 = h.seq;
+    uint32_t lo = 0, hi = _blocks;
+    while (hi - lo > 1) {
+      uint32_t mid = lo + (hi - lo) / 2;
+      if (newer(mid, seq0)) {
+        lo = mid;
+      } else {
+        hi = mid;
+      }
+    }
+    _next = (lo + 1) % _blocks;
+    _seq = seq0 + lo + 1;
+  } else {
+    // Empty, or the first block of a new round was torn: the newest block
+    // is then the last one of the region
+    _next = 0;
+    _seq = readHeader(_blocks - 1, h) ? h.seq + 1 : 0;
+  }
+
+  _thread.start(callback(this, &TSL2591Logger::run));
+  return 0;
+}
+
+/**************************************************************************/
+/*
+    Reads and checks a whole block, before the flush thread runs the
+    second RAM block is free to use for that
+*/
+/**************************************************************************/
+bool TSL2591Logger::readHeader(uint32_t index, TSL2591LogHeader &header) {
+  TSL2591LogBlock &block = _buffer[1];
+  if (_bd.read(&block, _start + (bd_addr_t)index * TSL2591_LOG_BLOCK_SIZE, TSL2591_LOG_BLOCK_SIZE)) {
+    return false;
+  }
+  if (block.header.magic != TSL2591_LOG_MAGIC || block.header.count > TSL2591_LOG_RECORDS) {
+    return false;
+  }
+  uint32_t stored = block.header.crc;
+  if (crc(block) != stored) {
+    return false;
+  }
+  header = block.header;
+  return true;
+}
+
+bool TSL2591Logger::newer(uint32_t index, uint32_t seq0) {
+  TSL2591LogHeader h;
+  return readHeader(index, h) && h.seq == seq0 + index;
+}
+
+uint32_t TSL2591Logger::crc(TSL2591LogBlock &block) {
+  MbedCRC<POLY_32BIT_ANSI, 32> ct;
+  uint32_t result = 0;
+  block.header.crc = 0;
+  ct.compute(&block, sizeof(block), &result);
+  block.header.crc = result;
+  return result;
+}
+
+bool TSL2591Logger::push(const TSL2591Sample &sample) {
+  if (_count == TSL2591_LOG_RECORDS) {
+    // Full but not handed over yet, the other one is still being written
+    if (core_util_atomic_load_bool(&_pending[_fill ^ 1])) {
+      _stats.dropped++;
+      return false;
+    }
+    seal();
+  }
+  _buffer[_fill].records[_count++] = sample;
+  _stats.records++;
+  if (_count == TSL2591_LOG_RECORDS && !core_util_atomic_load_bool(&_pending[_fill ^ 1])) {
+    seal();
+  }
+  return true;
+}
+
+void TSL2591Logger::flush(void) {
+  if (_count && !core_util_atomic_load_bool(&_pending[_fill ^ 1])) {
+    seal();
+  }
+}
+
+void TSL2591Logger::seal(void) {
+  TSL2591LogBlock &block = _buffer[_fill];
+  block.header.count = _count;
+  memset(&block.records[_count], 0, sizeof(block.records) - _count * sizeof(TSL2591Sample));
+  core_util_atomic_store_bool(&_pending[_fill], true);
+  _flush.release();
+  _fill ^= 1;
+  _count = 0;
+}
+
+TSL2591LoggerStats TSL2591Logger::stats(void) {
+  _statsMutex.lock();
+  TSL2591LoggerStats s = _stats;
+  s.records -= _lost;
+  s.dropped += _lost;
+  _statsMutex.unlock();
+  return s;
+}
+
+int TSL2591Logger::writeBlock(TSL2591LogBlock &block) {
+  bd_addr_t offset = (bd_addr_t)_next * TSL2591_LOG_BLOCK_SIZE;
+  int err = 0;
+
+  block.header.magic = TSL2591_LOG_MAGIC;
+  block.header.seq = _seq;
+  block.header.reserved = 0;
+  memset(block.pad, 0, sizeof(block.pad));
+  crc(block);
+
+  // Erase one unit ahead: entering an erase unit clears all of it
+  bool enter = offset % _eraseSize == 0;
+  if (_erase && (enter || _dirty)) {
+    if (!enter) {
+      // Rewritten after a failure, the erase takes the earlier blocks of
+      // the unit with it: the log goes on from its start
+      uint32_t back = (offset % _eraseSize) / TSL2591_LOG_BLOCK_SIZE;
+      _next -= back;
+      _seq -= back;
+      block.header.seq = _seq;
+      crc(block);
+      offset -= (bd_addr_t)back * TSL2591_LOG_BLOCK_SIZE;
+      _statsMutex.lock();
+      _lost += _unitRecords;
+      _statsMutex.unlock();
+    }
+    _unitRecords = 0;
+    err = _bd.erase(_start + offset, _eraseSize);
+  }
+  if (err == 0) {
+    err = _bd.program(&block, _start + offset, TSL2591_LOG_BLOCK_SIZE);
+  }
+  // A failed block is written again at the same place (after an erase on
+  // flash), the sequence numbers of the region stay consecutive for the
+  // resume search
+  _dirty = err != 0;
+  if (err == 0) {
+    _unitRecords += block.header.count;
+    _next = (_next + 1) % _blocks;
+    _seq++;
+  }
+  return err;
+}
+
+void TSL2591Logger::run(void) {
+  uint8_t write = 0;
+  while (true) {
+    _flush.acquire();
+
+    // The block stays pending while it is retried, push() fills the other one
+    int err;
+    for (int i = 0; ; i++) {
+      Timer timer;
+      timer.start();
+      err = writeBlock(_buffer[write]);
+      uint32_t us = (uint32_t)timer.elapsed_time().count();
+
+      _statsMutex.lock();
+      if (err) {
+        _stats.errors++;
+      }
+      if (us > _stats.maxWriteUs) {
+        _stats.maxWriteUs = us;
+      }
+      _statsMutex.unlock();
+      if (err == 0 || i == TSL2591_LOG_RETRIES) {
+        break;
+      }
+      ThisThread::sleep_for(std::chrono::milliseconds(TSL2591_LOG_RETRY_DELAY_MS));
+    }
+
+    _statsMutex.lock();
+    if (err) {
+      _lost += _buffer[write].header.count;
+    } else {
+      _stats.blocks++;
+    }
+    _statsMutex.unlock();
+
+    core_util_atomic_store_bool(&_pending[write], false);
+    write ^= 1;
+  }
+}
@@ -0,0 +1,139 @@
+/* TSL2591 Digital Light Sensor, block buffered sample log */
+
+#ifndef TSL2591_LOGGER_H
+#define TSL2591_LOGGER_H
+
+#include "mbed.h"
+#include "BlockDevice.h"
+#include "TSL2591Sample.h"
+
+// One log block, a multiple of the program size of SD cards and QSPI flash
+#ifndef TSL2591_LOG_BLOCK_SIZE
+#define TSL2591_LOG_BLOCK_SIZE (512)
+#endif
+
+// Writes of a block after a failed erase/program, and the delay before each
+#ifndef TSL2591_LOG_RETRIES
+#define TSL2591_LOG_RETRIES (3)
+#endif
+#ifndef TSL2591_LOG_RETRY_DELAY_MS
+#define TSL2591_LOG_RETRY_DELAY_MS (100)
+#endif
+
+#ifndef TSL2591_LOGGER_STACK_SIZE
+#define TSL2591_LOGGER_STACK_SIZE (1536)
+#endif
+
+// "TSLG" in little endian
+#define TSL2591_LOG_MAGIC (0x474C5354)
+
+struct TSL2591LogHeader {
+  uint32_t magic;
+  uint32_t seq;         // block sequence number, increments by one per block written
+  uint16_t count;       // valid records in this block
+  uint16_t reserved;
+  uint32_t crc;         // CRC-32 (zlib) of the whole block with crc = 0
+};
+
+#define TSL2591_LOG_RECORDS ((TSL2591_LOG_BLOCK_SIZE - sizeof(TSL2591LogHeader)) / sizeof(TSL2591Sample))
+
+struct TSL2591LogBlock {
+  TSL2591LogHeader header;
+  TSL2591Sample records[TSL2591_LOG_RECORDS];
+  uint8_t pad[TSL2591_LOG_BLOCK_SIZE - sizeof(TSL2591LogHeader) - TSL2591_LOG_RECORDS * sizeof(TSL2591Sample)];
+};
+
+struct TSL2591LoggerStats {
+  uint32_t records;     // accepted by push() and not lost since
+  uint32_t blocks;      // written to the device
+  uint32_t dropped;     // both RAM blocks busy or the block not written, record lost
+  uint32_t errors;      // failed erase/program
+  uint32_t maxWriteUs;  // slowest block write (erase included)
+};
+
+/**************************************************************************/
+/*
+    Logs TSL2591Sample records to a BlockDevice (SDBlockDevice,
+    QSPIFBlockDevice, ... BlockDevice::get_default_instance()) without
+    a file system. Records are collected in a RAM block of
+    TSL2591_LOG_BLOCK_SIZE bytes (41 records) and a full block is
+    written in one program() by a background thread, so the acquisition
+    side only copies 12 bytes and never waits for the device. With two
+    RAM blocks one can fill while the other is written, if both are busy
+    the record is dropped and counted.
+
+    The log is a ring over [start, start + size): blocks are written in
+    order and wrap around at the end, flash is erased one erase unit
+    ahead of the write position (nothing is erased twice per round, the
+    wear is spread over the whole region). init() finds the newest valid
+    block, the header CRC tells torn writes from complete ones, and
+    continues after it: a binary search over the sequence numbers, so
+    only about log2(blocks) blocks are read at boot.
+
+    A block that fails to erase or program stays in its RAM buffer and is
+    written again at the same place, TSL2591_LOG_RETRIES times, so the
+    sequence numbers of the region stay consecutive. On flash the erase
+    unit is erased again first, a partly programmed page can't be
+    programmed over. That also clears the blocks written before in the
+    same unit, the log then goes on from the start of the unit and their
+    records count as dropped like those of a block given up on.
+
+    Read an SD card image or a flash dump back with tools/tsl2591_log.py.
+*/
+/**************************************************************************/
+class TSL2591Logger {
+public:
+  /* size == 0 logs to the whole device */
+  TSL2591Logger(BlockDevice &bd, bd_addr_t start = 0, bd_size_t size = 0,
+                osPriority priority = osPriorityLow);
+
+  /* Mounts the device, finds the resume point and starts the flush thread */
+  int init(void);
+
+  /* Acquisition side, never blocks. False if the record was dropped */
+  bool push(const TSL2591Sample &sample);
+
+  /* Writes the partially filled block too, e.g. before a planned reset */
+  void flush(void);
+
+  /* Block index the next write goes to, and its sequence number */
+  uint32_t position(void) const { return _next; }
+  uint32_t sequence(void) const { return _seq; }
+  uint32_t blocks(void) const { return _blocks; }
+
+  TSL2591LoggerStats stats(void);
+
+private:
+  bool readHeader(uint32_t index, TSL2591LogHeader &header);
+  bool newer(uint32_t index, uint32_t seq0);
+  int writeBlock(TSL2591LogBlock &block);
+  void seal(void);
+  void run(void);
+
+  static uint32_t crc(TSL2591LogBlock &block);
+
+  BlockDevice &_bd;
+  bd_addr_t _start;
+  bd_size_t _size;
+  uint32_t _blocks;
+  uint32_t _next;
+  uint32_t _seq;
+  bd_size_t _eraseSize;
+  bool _erase;
+  bool _dirty;          // the last write failed, the unit needs an erase
+  uint32_t _unitRecords;
+
+  TSL2591LogBlock _buffer[2];
+  volatile bool _pending[2];
+  uint8_t _fill;
+  uint16_t _count;
+
+  TSL2591LoggerStats _stats;
+  uint32_t _lost;
+  Mutex _statsMutex;
+  Semaphore _flush;
+  MBED_ALIGN(8) unsigned char _stack[TSL2591_LOGGER_STACK_SIZE];
+  Thread _thread;
+};
+
+#endif
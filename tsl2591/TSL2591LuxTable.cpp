@@ -0,0 +1,39 @@
+/* TSL2591 Digital Light Sensor, table based batch lux conversion */
+
+#include "TSL2591LuxTable.h"
+
+// Gain multipliers used by calculateLux(), indexed by tsl2591Gain_t >> 4
+static const float againTable[4] = { 1.0F, 25.0F, 428.0F, 9876.0F };
+
+TSL2591LuxTable::TSL2591LuxTable(tsl2591Gain_t gain, tsl2591IntegrationTime_t timing) {
+  for (int g = 0; g < 4; g++) {
+    for (int t = 0; t < 6; t++) {
+      float atime = 100.0F * (t + 1);
+      _table[g][t] = TSL2591_LUX_DF / (atime * againTable[g]);
+    }
+  }
+  configure(gain, timing);
+}
+
+void TSL2591LuxTable::configure(tsl2591Gain_t gain, tsl2591IntegrationTime_t timing) {
+  _factor = factor(gain, timing);
+}
+
+float TSL2591LuxTable::calculateLux(uint16_t full, uint16_t ir) const {
+  return lux(full, ir, _factor);
+}
+
+void TSL2591LuxTable::calculateLux(const uint16_t *__restrict full, const uint16_t *__restrict ir,
+                                   float *__restrict out, size_t n) const {
+  const float k = _factor;
+  for (size_t i = 0; i < n; i++) {
+    out[i] = lux(full[i], ir[i], k);
+  }
+}
+
+void TSL2591LuxTable::calculateLux(const TSL2591Sample *__restrict samples, float *__restrict out, size_t n) const {
+  for (size_t i = 0; i < n; i++) {
+    const TSL2591Sample &s = samples[i];
+    out[i] = lux(s.full, s.ir, factor(s.gain, s.timing));
+  }
+}
@@ -0,0 +1,62 @@
+/* TSL2591 Digital Light Sensor, table based batch lux conversion */
+
+#ifndef TSL2591_LUX_TABLE_H
+#define TSL2591_LUX_TABLE_H
+
+#include "mbed.h"
+#include "Adafruit_TSL2591.h"
+#include "TSL2591Sample.h"
+
+/**************************************************************************/
+/*
+    Lux conversion for many samples at once. The per (gain, timing)
+    factor LUX_DF / (atime * again) is precomputed for all 24
+    combinations, configure() only selects the current one, so nothing
+    is re-derived per sample:
+
+      lux = (ch0 - ch1)^2 / ch0 * factor[gain][timing]
+
+    which is calculateLux() rewritten ((ch0 - ch1) * (1 - ch1 / ch0)).
+    The batch loops have no data dependent branches (overflow -1 and
+    ch0 == 0 -> 0 are selects) and restrict qualified pointers, so the
+    compiler can unroll and pipeline them. Note the Cortex-M7 FPU has no
+    float SIMD, the DSP SIMD instructions work on integers only; the
+    win here is the division-free setup and the branch free loop.
+*/
+/**************************************************************************/
+class TSL2591LuxTable {
+public:
+  TSL2591LuxTable(tsl2591Gain_t gain = TSL2591_GAIN_MED,
+                  tsl2591IntegrationTime_t timing = TSL2591_INTEGRATIONTIME_100MS);
+
+  /* Call after setGain()/setTiming() */
+  void configure(tsl2591Gain_t gain, tsl2591IntegrationTime_t timing);
+
+  float factor(void) const { return _factor; }
+  float factor(uint8_t gain, uint8_t timing) const { return _table[(gain >> 4) & 0x03][timing < 6 ? timing : 5]; }
+
+  /* Single sample with the configured gain/timing */
+  float calculateLux(uint16_t full, uint16_t ir) const;
+
+  /* n samples with the configured gain/timing */
+  void calculateLux(const uint16_t *full, const uint16_t *ir, float *out, size_t n) const;
+
+  /* n buffered samples, each converted with its own gain/timing */
+  void calculateLux(const TSL2591Sample *samples, float *out, size_t n) const;
+
+  static float lux(uint16_t full, uint16_t ir, float factor);
+
+private:
+  float _table[4][6];
+  float _factor;
+};
+
+inline float TSL2591LuxTable::lux(uint16_t full, uint16_t ir, float factor) {
+  float d = (float)full - (float)ir;
+  float f = (float)full;
+  float l = d * d / (full ? f : 1.0F) * factor;
+  l = full ? l : 0.0F;
+  return ((full == 0xFFFF) | (ir == 0xFFFF)) ? -1.0F : l;
+}
+
+#endif
@@ -0,0 +1,148 @@
+/* TSL2591 Digital Light Sensor, I2C bus recovery and sensor re-init */
+
+#include "TSL2591Recovery.h"
+#include <new>
+
+// Half of a 100 kHz SCL period
+#define TSL2591_UNLOCK_HALF_PERIOD_US (5)
+
+TSL2591Recovery::TSL2591Recovery(Adafruit_TSL2591 &tsl, TSL2591Registers &regs, PinName sda, PinName scl)
+  : _tsl(tsl), _regs(regs), _sda(sda), _scl(scl), _hz(100000), _haveConfig(false),
+    _haveControl(false), _restored(true), _enable(0), _control(0), _recoveries(0), _failed(0), _lastRecoveryUs(0) {
+}
+
+void TSL2591Recovery::configured(int hz) {
+  _hz = hz;
+  if (!_regs.valid()) {
+    _regs.resync();
+  }
+  if (_regs.valid()) {
+    for (size_t i = 0; i < sizeof(_config); i++) {
+      _config[i] = (char)_regs.shadow(TSL2591_REGISTER_THRESHOLD_AILTL + i);
+    }
+    _haveConfig = true;
+  }
+}
+
+void TSL2591Recovery::attach(void) {
+  _regs.attachRecovery(callback(this, &TSL2591Recovery::recover));
+}
+
+bool TSL2591Recovery::begin(int hz, uint8_t attempts) {
+  // configured() hasn't run yet, reinitBus() needs the clock now
+  _hz = hz;
+  for (uint8_t i = 0; i < attempts; i++) {
+    if (i) {
+      unlockBus();
+      reinitBus();
+    }
+    if (_tsl.begin(_regs.i2c())) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**************************************************************************/
+/*
+    Open drain by hand: a released line is an input with pull up, only
+    low is actively driven
+*/
+/**************************************************************************/
+static void release(DigitalInOut &pin) {
+  pin.input();
+}
+
+static void driveLow(DigitalInOut &pin) {
+  pin.write(0);
+  pin.output();
+}
+
+bool TSL2591Recovery::unlockBus(void) {
+  bool released;
+  {
+    DigitalInOut sda(_sda, PIN_INPUT, PullUp, 1);
+    DigitalInOut scl(_scl, PIN_INPUT, PullUp, 1);
+
+    wait_us(TSL2591_UNLOCK_HALF_PERIOD_US);
+    for (int i = 0; i < 9 && !sda.read(); i++) {
+      driveLow(scl);
+      wait_us(TSL2591_UNLOCK_HALF_PERIOD_US);
+      release(scl);
+      wait_us(TSL2591_UNLOCK_HALF_PERIOD_US);
+    }
+    released = sda.read();
+
+    // STOP: SDA low to high while SCL is high
+    driveLow(scl);
+    wait_us(TSL2591_UNLOCK_HALF_PERIOD_US);
+    driveLow(sda);
+    wait_us(TSL2591_UNLOCK_HALF_PERIOD_US);
+    release(scl);
+    wait_us(TSL2591_UNLOCK_HALF_PERIOD_US);
+    release(sda);
+    wait_us(TSL2591_UNLOCK_HALF_PERIOD_US);
+  }
+  return released;
+}
+
+void TSL2591Recovery::reinitBus(void) {
+  // The pins are GPIOs now, constructing the I2C again routes them back
+  // to the peripheral and resets its state machine
+  I2C &i2c = _regs.i2c();
+  i2c.~I2C();
+  new (&i2c) I2C(_sda, _scl);
+  i2c.frequency(_hz);
+}
+
+int TSL2591Recovery::recover(void) {
+  Timer timer;
+  timer.start();
+  _recoveries++;
+
+  // What the sensor ran with. After a failed recovery the shadow may have
+  // been loaded from the half configured sensor, the saved values stay
+  if (_regs.valid() && _restored) {
+    _enable = _regs.shadow(TSL2591_REGISTER_ENABLE);
+    _control = _regs.shadow(TSL2591_REGISTER_CONTROL);
+    _haveControl = true;
+  }
+
+  int err = -1;
+  for (int i = 0; err && i < TSL2591_RECOVERY_ATTEMPTS; i++) {
+    err = restore();
+  }
+  _restored = err == 0;
+  if (err) {
+    _failed++;
+  }
+  _lastRecoveryUs = (uint32_t)timer.elapsed_time().count();
+  return err;
+}
+
+/**************************************************************************/
+/*
+    One pass of unlock, re-init and restore of the saved configuration
+*/
+/**************************************************************************/
+int TSL2591Recovery::restore(void) {
+  unlockBus();
+  reinitBus();
+  _regs.invalidate();
+
+  int err = _tsl.begin(_regs.i2c()) ? 0 : -1;
+  if (err == 0 && _haveControl) {
+    err = _regs.write8(TSL2591_REGISTER_CONTROL, _control);
+  }
+  if (err == 0 && _haveConfig) {
+    err = _regs.write(TSL2591_REGISTER_THRESHOLD_AILTL, _config, sizeof(_config));
+  }
+  if (err == 0 && _haveControl) {
+    // Last, a running ALS starts over with the complete configuration
+    err = _regs.write8(TSL2591_REGISTER_ENABLE, _enable);
+  }
+  if (err == 0) {
+    err = _regs.resync();
+  }
+  return err;
+}
@@ -0,0 +1,95 @@
+/* TSL2591 Digital Light Sensor, I2C bus recovery and sensor re-init */
+
+#ifndef TSL2591_RECOVERY_H
+#define TSL2591_RECOVERY_H
+
+#include "mbed.h"
+#include "Adafruit_TSL2591.h"
+#include "TSL2591Registers.h"
+
+// Complete unlock, re-init and restore sequences tried by recover()
+#ifndef TSL2591_RECOVERY_ATTEMPTS
+#define TSL2591_RECOVERY_ATTEMPTS (3)
+#endif
+
+/**************************************************************************/
+/*
+    Gets a glitched bus and sensor back into a known state, without a
+    power cycle:
+
+      1. bus unlock: a slave that lost clocks mid-byte can hold SDA low
+         forever. Up to 9 SCL pulses (bit banged) let it shift out the
+         rest of the byte, then a STOP condition ends the transfer.
+      2. the I2C object is re-created on the same pins, which puts the
+         peripheral back into master mode with a clean state machine.
+      3. begin() re-initializes the sensor. The gain and integration
+         time it writes are the ones cached in Adafruit_TSL2591, they are
+         replaced by the last CONTROL of the register shadow (changed by
+         TSL2591AutoRange or TSL2591Service since), the thresholds and
+         persist filter saved by configured() are written back. begin()
+         powers the sensor off, ENABLE of the shadow comes last so the
+         modes that keep the ALS running (TSL2591Continuous,
+         TSL2591Scheduler, data ready interrupt) carry on.
+
+    The steps are repeated up to TSL2591_RECOVERY_ATTEMPTS times until
+    all transfers went through. A sensor left half configured by a
+    recovery that failed anyway is not taken for the wanted state: the
+    next recovery writes the values saved before again.
+
+    attach() makes TSL2591Registers call recover() when a transfer fails
+    after its retries, so the retry after that normally succeeds. The
+    whole recovery takes a few ms (9 clocks at 100 kHz + a few transfers).
+
+    The I2C object must not be used from another thread while recover()
+    runs, it is destroyed and constructed again in place (the references
+    held by Adafruit_TSL2591 and TSL2591Registers stay valid).
+*/
+/**************************************************************************/
+class TSL2591Recovery {
+public:
+  TSL2591Recovery(Adafruit_TSL2591 &tsl, TSL2591Registers &regs, PinName sda, PinName scl);
+
+  /* Remembers bus clock and thresholds/persist, call after configuring */
+  void configured(int hz);
+
+  /* Installs recover() as the recovery handler of the registers */
+  void attach(void);
+
+  /*
+      begin() with recovery between the attempts, gives up after attempts
+      tries instead of hanging. hz is the bus clock the I2C is set back
+      to after a re-init. Returns true when the sensor answered.
+  */
+  bool begin(int hz, uint8_t attempts = 3);
+
+  /* Unlock, re-init of the I2C peripheral and the sensor. 0 on success */
+  int recover(void);
+
+  /* Clocks SCL until SDA is released (at most 9 times) and sends a STOP */
+  bool unlockBus(void);
+
+  uint32_t recoveries(void) const { return _recoveries; }
+  uint32_t failed(void) const { return _failed; }
+  uint32_t lastRecoveryUs(void) const { return _lastRecoveryUs; }
+
+private:
+  void reinitBus(void);
+  int restore(void);
+
+  Adafruit_TSL2591 &_tsl;
+  TSL2591Registers &_regs;
+  PinName _sda;
+  PinName _scl;
+  int _hz;
+  bool _haveConfig;
+  bool _haveControl;
+  bool _restored;       // the last recovery went through
+  uint8_t _enable;
+  uint8_t _control;
+  char _config[TSL2591_REGISTER_PERSIST_FILTER - TSL2591_REGISTER_THRESHOLD_AILTL + 1];
+  uint32_t _recoveries;
+  uint32_t _failed;
+  uint32_t _lastRecoveryUs;
+};
+
+#endif
@@ -0,0 +1,269 @@
+/* TSL2591 Digital Light Sensor, direct register access */
+
+#include "TSL2591Registers.h"
+
+static const int frequencies[] = { 1000000, 400000, 100000 };
+
+TSL2591Registers::TSL2591Registers(I2C &i2c, uint8_t addr)
+  : _i2c(i2c), _addr(addr), _valid(false), _retries(TSL2591_I2C_RETRIES), _recovering(false),
+    _retryDelay(TSL2591_I2C_RETRY_DELAY_MS) {
+  memset(_shadow, 0, sizeof(_shadow));
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+void TSL2591Registers::setRetries(uint8_t retries, std::chrono::milliseconds retryDelay) {
+  _retries = retries;
+  _retryDelay = retryDelay;
+}
+
+/**************************************************************************/
+/*
+    One attempt of a bus operation, without retries
+*/
+/**************************************************************************/
+int TSL2591Registers::attempt(Op op, uint8_t reg, char *data, int len) {
+  char cmd[1 + TSL2591_SHADOW_SIZE];
+  int err = -1;
+  cmd[0] = (char)(TSL2591_COMMAND_BIT | reg);
+
+  // Begin/end events of read, write and command follow each other in that order
+  TSL2591_TRACE_POINT(TSL2591_TRACE_READ_BEGIN + 2 * op, reg, len);
+  switch (op) {
+    case OP_READ:
+      // Repeated start. I2C releases its mutex after each call, the lock
+      // keeps other threads off the bus between the write and the read
+      _i2c.lock();
+      err = _i2c.write(_addr << 1, cmd, 1, true);
+      if (err) {
+        _i2c.stop();
+      } else {
+        err = _i2c.read(_addr << 1, data, len);
+      }
+      _i2c.unlock();
+      break;
+    case OP_WRITE:
+      memcpy(&cmd[1], data, len);
+      err = _i2c.write(_addr << 1, cmd, len + 1);
+      break;
+    case OP_COMMAND:
+      cmd[0] = (char)reg;
+      err = _i2c.write(_addr << 1, cmd, 1);
+      break;
+  }
+  TSL2591_TRACE_POINT(TSL2591_TRACE_READ_END + 2 * op, reg, err);
+  return err;
+}
+
+int TSL2591Registers::transfer(Op op, uint8_t reg, char *data, int len) {
+  _stats.transfers++;
+  int err = attempt(op, reg, data, len);
+  for (uint8_t i = 0; err && i < _retries; i++) {
+    _stats.errors++;
+    _stats.retries++;
+    TSL2591_TRACE_POINT(TSL2591_TRACE_RETRY, reg, i + 1);
+    ThisThread::sleep_for(_retryDelay);
+    err = attempt(op, reg, data, len);
+  }
+  if (err) {
+    _stats.errors++;
+    // Not from within the handler, it talks to the sensor through us
+    if (_recover && !_recovering) {
+      _recovering = true;
+      _stats.recoveries++;
+      TSL2591_TRACE_POINT(TSL2591_TRACE_RECOVERY_BEGIN, reg, 0);
+      int result = _recover();
+      TSL2591_TRACE_POINT(TSL2591_TRACE_RECOVERY_END, reg, result);
+      if (result == 0) {
+        // What the channels hold now is not the conversion the caller waited for
+        bool channels = op == OP_READ && reg <= TSL2591_REGISTER_CHAN1_HIGH &&
+                        reg + len > TSL2591_REGISTER_CHAN0_LOW;
+        err = channels ? TSL2591_ERROR_RECOVERED : attempt(op, reg, data, len);
+      }
+      _recovering = false;
+    }
+  }
+  if (err) {
+    _stats.failures++;
+    // The recovery has just loaded the shadow
+    if (err != TSL2591_ERROR_RECOVERED) {
+      _valid = false;
+    }
+  }
+  return err;
+}
+
+int TSL2591Registers::setFrequency(int hz) {
+  const size_t count = sizeof(frequencies) / sizeof(frequencies[0]);
+  size_t next = 0;
+  int f = hz;
+
+  while (f > 0) {
+    uint8_t id = 0;
+    _i2c.frequency(f);
+    if (read8(TSL2591_REGISTER_DEVICE_ID, id) == 0 && id == TSL2591_CHIP_ID) {
+      return f;
+    }
+    // Next slower standard clock
+    while (next < count && frequencies[next] >= f) {
+      next++;
+    }
+    f = (next < count) ? frequencies[next] : 0;
+  }
+  _i2c.frequency(frequencies[count - 1]);
+  return 0;
+}
+
+int TSL2591Registers::write8(uint8_t reg, uint8_t value) {
+  char data = (char)value;
+  return write(reg, &data, 1);
+}
+
+int TSL2591Registers::write(uint8_t reg, const char *data, int len) {
+  char cmd[TSL2591_SHADOW_SIZE];
+  if (len > TSL2591_SHADOW_SIZE) {
+    return -1;
+  }
+  memcpy(cmd, data, len);
+  int err = transfer(OP_WRITE, reg, cmd, len);
+  if (err == 0) {
+    updateShadow(reg, data, len);
+  }
+  return err;
+}
+
+int TSL2591Registers::read8(uint8_t reg, uint8_t &value) {
+  if (_valid && shadowed(reg)) {
+    value = _shadow[reg];
+    return 0;
+  }
+  char data;
+  int err = read(reg, &data, 1);
+  if (err == 0) {
+    value = (uint8_t)data;
+  }
+  return err;
+}
+
+int TSL2591Registers::read(uint8_t reg, char *data, int len) {
+  return transfer(OP_READ, reg, data, len);
+}
+
+int TSL2591Registers::resync(void) {
+  char data[TSL2591_SHADOW_SIZE];
+  int err = read(TSL2591_REGISTER_ENABLE, data, sizeof(data));
+  if (err == 0) {
+    memcpy(_shadow, data, sizeof(_shadow));
+    _valid = true;
+  }
+  return err;
+}
+
+int TSL2591Registers::setControl(tsl2591Gain_t gain, tsl2591IntegrationTime_t timing) {
+  uint8_t value = gain | timing;
+  if (_valid && _shadow[TSL2591_REGISTER_CONTROL] == value) {
+    return 0;
+  }
+  return write8(TSL2591_REGISTER_CONTROL, value);
+}
+
+int TSL2591Registers::setThresholds(uint16_t lower, uint16_t upper) {
+  return setThresholdPair(TSL2591_REGISTER_THRESHOLD_AILTL, lower, upper);
+}
+
+int TSL2591Registers::setNoPersistThresholds(uint16_t lower, uint16_t upper) {
+  return setThresholdPair(TSL2591_REGISTER_THRESHOLD_NPAILTL, lower, upper);
+}
+
+int TSL2591Registers::setPersist(tsl2591Persist_t persist) {
+  if (_valid && _shadow[TSL2591_REGISTER_PERSIST_FILTER] == persist) {
+    return 0;
+  }
+  return write8(TSL2591_REGISTER_PERSIST_FILTER, persist);
+}
+
+int TSL2591Registers::setThresholdPair(uint8_t reg, uint16_t lower, uint16_t upper) {
+  char data[4] = { (char)(lower & 0xFF), (char)(lower >> 8), (char)(upper & 0xFF), (char)(upper >> 8) };
+  if (_valid && memcmp(&_shadow[reg], data, sizeof(data)) == 0) {
+    return 0;
+  }
+  // All four bytes in one auto increment write
+  return write(reg, data, sizeof(data));
+}
+
+void TSL2591Registers::updateShadow(uint8_t reg, const char *data, int len) {
+  for (int i = 0; i < len; i++, reg++) {
+    if (reg == TSL2591_REGISTER_CONTROL && (data[i] & TSL2591_CONTROL_RESET)) {
+      // A software reset puts every register back to its default
+      _valid = false;
+      return;
+    }
+    if (shadowed(reg)) {
+      _shadow[reg] = (uint8_t)data[i];
+    }
+  }
+}
+
+int TSL2591Registers::command(uint8_t cmd) {
+  return transfer(OP_COMMAND, cmd, NULL, 0);
+}
+
+int TSL2591Registers::readChannels(uint32_t &lum) {
+  char data[4];
+  int err = read(TSL2591_REGISTER_CHAN0_LOW, data, sizeof(data));
+  if (err == 0) {
+    lum = packChannels(data);
+  }
+  return err;
+}
+
+int TSL2591Registers::readFullLuminosity(tsl2591IntegrationTime_t timing, uint32_t &lum) {
+  int err = write8(TSL2591_REGISTER_ENABLE, TSL2591_ENABLE_POWERON | TSL2591_ENABLE_AEN);
+  if (err) {
+    return err;
+  }
+  TSL2591_TRACE_POINT(TSL2591_TRACE_WAIT_BEGIN, timing, conversionTime(timing).count());
+  if (_wait) {
+    err = _wait(timing);
+  } else {
+    ThisThread::sleep_for(conversionTime(timing));
+  }
+  TSL2591_TRACE_POINT(TSL2591_TRACE_WAIT_END, timing, err);
+  if (err == 0) {
+    err = readChannels(lum);
+  }
+  write8(TSL2591_REGISTER_ENABLE, TSL2591_ENABLE_POWEROFF);
+  return err;
+}
+
+int TSL2591Registers::waitValid(tsl2591IntegrationTime_t timing) {
+  Kernel::Clock::time_point start = Kernel::Clock::now();
+  Kernel::Clock::time_point timeout = start + conversionTime(timing);
+
+  // Nothing to see before the integration is nearly done
+  ThisThread::sleep_for(std::chrono::milliseconds(TSL2591_READY_FIRST_POLL_PERCENT * (timing + 1)));
+  while (true) {
+    char status;
+    int err = read(TSL2591_REGISTER_DEVICE_STATUS, &status, 1);
+    if (err) {
+      return err;
+    }
+    if (status & TSL2591_STATUS_AVALID) {
+      return 0;
+    }
+    if (Kernel::Clock::now() >= timeout) {
+      return -1;
+    }
+    ThisThread::sleep_for(std::chrono::milliseconds(TSL2591_READY_POLL_MS));
+  }
+}
+
+uint32_t TSL2591Registers::packChannels(const char data[4]) {
+  uint16_t full = (uint8_t)data[0] | ((uint8_t)data[1] << 8);
+  uint16_t ir   = (uint8_t)data[2] | ((uint8_t)data[3] << 8);
+  return ((uint32_t)ir << 16) | full;
+}
+
+std::chrono::milliseconds TSL2591Registers::conversionTime(tsl2591IntegrationTime_t timing) {
+  // One integration step is nominally 100 ms, getFullLuminosity() waits 120 ms per step
+  return std::chrono::milliseconds(120 * (timing + 1));
+}
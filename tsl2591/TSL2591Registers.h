@@ -0,0 +1,192 @@
+/* TSL2591 Digital Light Sensor, direct register access */
+
+#ifndef TSL2591_REGISTERS_H
+#define TSL2591_REGISTERS_H
+
+#include "mbed.h"
+#include "Adafruit_TSL2591.h"
+#include "TSL2591Trace.h"
+
+// Content of the ID register
+#define TSL2591_CHIP_ID (0x50)
+
+// Bits of the STATUS register
+#define TSL2591_STATUS_AVALID (0x01)
+#define TSL2591_STATUS_AINT   (0x10)
+#define TSL2591_STATUS_NPINTR (0x20)
+
+// AVALID polling: first look after this share of the nominal integration time
+#ifndef TSL2591_READY_FIRST_POLL_PERCENT
+#define TSL2591_READY_FIRST_POLL_PERCENT (90)
+#endif
+#ifndef TSL2591_READY_POLL_MS
+#define TSL2591_READY_POLL_MS (2)
+#endif
+
+// Configuration registers kept in RAM: ENABLE .. PERSIST_FILTER
+#define TSL2591_SHADOW_SIZE (TSL2591_REGISTER_PERSIST_FILTER + 1)
+
+// Default retries of a failed transfer and the delay before each of them
+#ifndef TSL2591_I2C_RETRIES
+#define TSL2591_I2C_RETRIES (2)
+#endif
+#ifndef TSL2591_I2C_RETRY_DELAY_MS
+#define TSL2591_I2C_RETRY_DELAY_MS (1)
+#endif
+
+// A read of the channel registers that needed a bus recovery. The
+// sensor was re-initialized in between, the conversion has to be run again
+#define TSL2591_ERROR_RECOVERED (-2)
+
+// Counters of the bus layer, see TSL2591Registers::busStats()
+struct TSL2591BusStats {
+  uint32_t transfers;  // read/write/command calls
+  uint32_t errors;     // failed attempts, retries included
+  uint32_t retries;    // attempts after the first one
+  uint32_t recoveries; // calls of the recovery handler
+  uint32_t failures;   // calls that returned an error in the end
+};
+
+/**************************************************************************/
+/*
+    Thin register level access to a TSL2591 on an mbed I2C bus, for the
+    things the Adafruit_TSL2591 API doesn't cover. All functions return
+    the I2C result: 0 on success, non-zero if the sensor didn't ACK.
+
+    Command bytes use TSL2591_COMMAND_BIT (normal operation, auto
+    increment), so a multi byte read walks through consecutive registers.
+
+    ENABLE, CONTROL, the threshold registers and PERSIST are shadowed in
+    RAM. Writes update the shadow, reads of these registers and gain()/
+    timing() are answered from it without bus traffic, and the setters
+    below skip writes that wouldn't change anything. The shadow is loaded
+    by resync() (one 13 byte burst read) and dropped on any bus error or
+    software reset. Adafruit_TSL2591 writes the same registers behind our
+    back: call resync() after using its setters or registerInterrupt().
+
+    A failed transfer is retried up to retries times, retryDelay apart.
+    If it still fails and a recovery handler is attached (see
+    TSL2591Recovery) the handler gets one chance to bring bus and sensor
+    back and the transfer is tried once more. Reads of the channel
+    registers are not: the recovery powered the sensor down and reset its
+    conversion, they return TSL2591_ERROR_RECOVERED instead. The worst
+    case time of a call is therefore bounded, and the result is always an
+    error code, never stale data.
+*/
+/**************************************************************************/
+class TSL2591Registers {
+public:
+  TSL2591Registers(I2C &i2c, uint8_t addr = TSL2591_ADDR);
+
+  int write8(uint8_t reg, uint8_t value);
+  int read8(uint8_t reg, uint8_t &value);
+  int read(uint8_t reg, char *data, int len);
+  int write(uint8_t reg, const char *data, int len);
+
+  /* Reloads the shadow registers from the sensor */
+  int resync(void);
+  void invalidate(void) { _valid = false; }
+  bool valid(void) const { return _valid; }
+
+  /* Configuration through the shadow, unchanged values cost no I2C */
+  int setControl(tsl2591Gain_t gain, tsl2591IntegrationTime_t timing);
+  int setThresholds(uint16_t lower, uint16_t upper);
+  int setNoPersistThresholds(uint16_t lower, uint16_t upper);
+  int setPersist(tsl2591Persist_t persist);
+
+  /* Served from the shadow, only meaningful while valid() */
+  tsl2591Gain_t gain(void) const { return (tsl2591Gain_t)(_shadow[TSL2591_REGISTER_CONTROL] & 0x30); }
+  tsl2591IntegrationTime_t timing(void) const { return (tsl2591IntegrationTime_t)(_shadow[TSL2591_REGISTER_CONTROL] & 0x07); }
+  uint8_t shadow(uint8_t reg) const { return _shadow[reg]; }
+
+  /*
+      Sets the bus clock and checks that the ID register still reads
+      back correctly. On a NACK or a wrong ID it falls back to the next
+      slower standard clock (1 MHz Fast-mode Plus, 400 kHz Fast mode,
+      100 kHz). Returns the clock in use or 0 if the sensor doesn't answer
+      at all. The TSL2591 itself is specified up to 400 kHz, faster only
+      makes sense for the other devices on a shared bus. Call it before
+      Adafruit_TSL2591::begin().
+  */
+  int setFrequency(int hz);
+
+  /* Sends a special function command like TSL2591_CLEAR_INT */
+  int command(uint8_t cmd);
+
+  /*
+      Reads C0DATAL..C1DATAH with a single repeated start, auto increment
+      transfer (register address + 4 data bytes). Reading C0DATAL latches
+      the other three bytes in the sensor, so CH0 and CH1 always belong
+      to the same conversion. lum is packed like getFullLuminosity().
+  */
+  int readChannels(uint32_t &lum);
+
+  /*
+      Blocking equivalent of getFullLuminosity() built on readChannels():
+      powers the ALS up, waits for one integration and powers it down.
+      Without a wait handler it sleeps the worst case conversionTime(),
+      see attachWait() to read as soon as the data is valid.
+  */
+  int readFullLuminosity(tsl2591IntegrationTime_t timing, uint32_t &lum);
+
+  /*
+      Waits for the first conversion after AEN: sleeps
+      TSL2591_READY_FIRST_POLL_PERCENT of the nominal integration time,
+      then polls AVALID in STATUS every TSL2591_READY_POLL_MS. Returns 0
+      once valid, the I2C error, or -1 after conversionTime().
+  */
+  int waitValid(tsl2591IntegrationTime_t timing);
+
+  /*
+      Replaces the fixed sleep of readFullLuminosity(), the handler is
+      called with the ALS enabled and returns 0 when the data is valid:
+
+        regs.attachWait(callback(&regs, &TSL2591Registers::waitValid));
+
+      or a TSL2591DataReady for the INT pin.
+  */
+  void attachWait(Callback<int(tsl2591IntegrationTime_t)> wait) { _wait = wait; }
+
+  /* Packs the 4 bytes C0DATAL..C1DATAH into IR << 16 | full spectrum */
+  static uint32_t packChannels(const char data[4]);
+
+  /* Time getFullLuminosity() waits for one conversion (with margin) */
+  static std::chrono::milliseconds conversionTime(tsl2591IntegrationTime_t timing);
+
+  /* Bounded retries, 0 retries gives the old single attempt behavior */
+  void setRetries(uint8_t retries, std::chrono::milliseconds retryDelay);
+
+  /* Called when all retries failed, returns 0 if the bus is usable again */
+  void attachRecovery(Callback<int()> recover) { _recover = recover; }
+
+  const TSL2591BusStats &busStats(void) const { return _stats; }
+  void resetBusStats(void) { memset(&_stats, 0, sizeof(_stats)); }
+
+  I2C &i2c(void) { return _i2c; }
+  uint8_t address(void) const { return _addr; }
+
+  static bool shadowed(uint8_t reg) {
+    return reg < TSL2591_SHADOW_SIZE && reg != 0x02 && reg != 0x03;
+  }
+
+private:
+  enum Op { OP_READ, OP_WRITE, OP_COMMAND };
+
+  int transfer(Op op, uint8_t reg, char *data, int len);
+  int attempt(Op op, uint8_t reg, char *data, int len);
+  int setThresholdPair(uint8_t reg, uint16_t lower, uint16_t upper);
+  void updateShadow(uint8_t reg, const char *data, int len);
+
+  I2C &_i2c;
+  uint8_t _addr;
+  bool _valid;
+  uint8_t _shadow[TSL2591_SHADOW_SIZE];
+  uint8_t _retries;
+  bool _recovering;
+  std::chrono::milliseconds _retryDelay;
+  Callback<int()> _recover;
+  Callback<int(tsl2591IntegrationTime_t)> _wait;
+  TSL2591BusStats _stats;
+};
+
+#endif
@@ -0,0 +1,93 @@
+/* TSL2591 Digital Light Sensor, single producer/single consumer sample buffer */
+
+#ifndef TSL2591_RING_BUFFER_H
+#define TSL2591_RING_BUFFER_H
+
+#include "mbed.h"
+
+/**************************************************************************/
+/*
+    Fixed capacity FIFO between exactly one producer (sensor thread or
+    ISR) and one consumer (thread). Unlike mbed's CircularBuffer it
+    needs no critical section: the producer only writes _head, the
+    consumer only writes _tail, and the atomic load/store (with barrier)
+    of the indices orders the element copy against them. Storage is
+    part of the object, declare it static/global to keep it off the heap.
+
+    A full buffer drops the new element (acquisition never blocks), the
+    drops are counted in dropped(). N must be a power of two.
+*/
+/**************************************************************************/
+template <typename T, uint32_t N>
+class TSL2591RingBuffer {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "N must be a power of two");
+
+public:
+  TSL2591RingBuffer() : _head(0), _tail(0), _dropped(0) {
+  }
+
+  /* Producer side, returns false (and counts a drop) when full */
+  bool push(const T &item) {
+    uint32_t head = _head;
+    if (head - core_util_atomic_load_u32(&_tail) >= N) {
+      _dropped++;
+      return false;
+    }
+    _buffer[head & (N - 1)] = item;
+    core_util_atomic_store_u32(&_head, head + 1);
+    return true;
+  }
+
+  /* Consumer side, returns false when empty */
+  bool pop(T &item) {
+    uint32_t tail = _tail;
+    if (core_util_atomic_load_u32(&_head) == tail) {
+      return false;
+    }
+    item = _buffer[tail & (N - 1)];
+    core_util_atomic_store_u32(&_tail, tail + 1);
+    return true;
+  }
+
+  /* Consumer side: element the next pop() returns, without removing it */
+  const T *peek(void) const {
+    uint32_t tail = _tail;
+    if (core_util_atomic_load_u32(&_head) == tail) {
+      return NULL;
+    }
+    return &_buffer[tail & (N - 1)];
+  }
+
+  /* Consumer side: contiguous run of elements from the tail, for in place
+     block processing. Stays valid until consume() releases it */
+  uint32_t readable(T *&first) {
+    uint32_t tail = _tail;
+    uint32_t n = core_util_atomic_load_u32(&_head) - tail;
+    uint32_t toEnd = N - (tail & (N - 1));
+    first = &_buffer[tail & (N - 1)];
+    return n < toEnd ? n : toEnd;
+  }
+
+  /* Consumer side: drops n elements returned by readable() */
+  void consume(uint32_t n) {
+    core_util_atomic_store_u32(&_tail, _tail + n);
+  }
+
+  uint32_t size(void) const {
+    return core_util_atomic_load_u32(&_head) - core_util_atomic_load_u32(&_tail);
+  }
+
+  bool empty(void) const { return size() == 0; }
+  static uint32_t capacity(void) { return N; }
+
+  /* Only written by the producer, read it from there or accept a stale value */
+  uint32_t dropped(void) const { return _dropped; }
+
+private:
+  T _buffer[N];
+  volatile uint32_t _head;
+  volatile uint32_t _tail;
+  uint32_t _dropped;
+};
+
+#endif
@@ -0,0 +1,56 @@
+/* TSL2591 Digital Light Sensor, compact sample record */
+
+#ifndef TSL2591_SAMPLE_H
+#define TSL2591_SAMPLE_H
+
+#include "mbed.h"
+#include "Adafruit_TSL2591.h"
+
+// Full scale of the ADCs, at 100 ms the counter can't go higher than 0x8FFF
+#ifndef TSL2591_MAX_COUNT_100MS
+#define TSL2591_MAX_COUNT_100MS (36863)
+#endif
+#ifndef TSL2591_MAX_COUNT
+#define TSL2591_MAX_COUNT (65535)
+#endif
+
+// TSL2591Sample::flags
+#define TSL2591_SAMPLE_SATURATED    (0x01)   // CH0 or CH1 at full scale, the lux value is meaningless
+#define TSL2591_SAMPLE_RECONFIGURED (0x02)   // first sample with a new gain/timing (TSL2591Service)
+
+/**************************************************************************/
+/*
+    One raw reading with everything needed to convert it later
+    (calculateLux() needs gain and timing), 12 bytes. make() flags
+    clipped readings, retries counts the conversions that were thrown
+    away to get this one (see TSL2591Saturation).
+*/
+/**************************************************************************/
+struct TSL2591Sample {
+  uint32_t timestamp;   // Kernel::Clock in ms (wraps after ~49 days)
+  uint16_t full;        // CH0, full spectrum
+  uint16_t ir;          // CH1, infrared
+  uint8_t gain;         // tsl2591Gain_t
+  uint8_t timing;       // tsl2591IntegrationTime_t
+  uint8_t flags;        // TSL2591_SAMPLE_*
+  uint8_t retries;      // conversions discarded before this one
+
+  static TSL2591Sample make(uint16_t full, uint16_t ir, tsl2591Gain_t gain, tsl2591IntegrationTime_t timing) {
+    TSL2591Sample s;
+    s.timestamp = (uint32_t)Kernel::Clock::now().time_since_epoch().count();
+    s.full = full;
+    s.ir = ir;
+    s.gain = gain;
+    s.timing = timing;
+    s.flags = saturated(full, ir, timing) ? TSL2591_SAMPLE_SATURATED : 0;
+    s.retries = 0;
+    return s;
+  }
+
+  static bool saturated(uint16_t full, uint16_t ir, tsl2591IntegrationTime_t timing) {
+    uint16_t max = (timing == TSL2591_INTEGRATIONTIME_100MS) ? TSL2591_MAX_COUNT_100MS : TSL2591_MAX_COUNT;
+    return full >= max || ir >= max;
+  }
+};
+
+#endif
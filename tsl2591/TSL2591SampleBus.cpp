@@ -0,0 +1,80 @@
+/* TSL2591 Digital Light Sensor, publish/subscribe distribution of samples */
+
+#include "TSL2591SampleBus.h"
+
+TSL2591SampleBus::TSL2591SampleBus(void) : _count(0), _poolExhausted(0) {
+}
+
+int TSL2591SampleBus::subscribe(uint16_t decimation) {
+  if (_count >= TSL2591_BUS_MAX_SUBSCRIBERS) {
+    return -1;
+  }
+  Subscriber &sub = _subscribers[_count];
+  sub.decimation = decimation ? decimation : 1;
+  sub.phase = 0;
+  memset(&sub.stats, 0, sizeof(sub.stats));
+  return (int)_count++;
+}
+
+bool TSL2591SampleBus::publish(const TSL2591Sample &sample) {
+  Entry *entry = _pool.try_alloc();
+  if (entry == NULL) {
+    _poolExhausted++;
+    return false;
+  }
+  entry->sample = sample;
+  // The publisher holds one reference while handing it out, so a fast
+  // subscriber can't free the entry before the loop is through
+  entry->refs = 1;
+
+  for (size_t i = 0; i < _count; i++) {
+    Subscriber &sub = _subscribers[i];
+    if (++sub.phase < sub.decimation) {
+      continue;
+    }
+    sub.phase = 0;
+
+    core_util_atomic_incr_u32(&entry->refs, 1);
+    while (!sub.queue.try_put(entry)) {
+      // Drop oldest: make room by taking the head out ourselves
+      Entry *old;
+      if (sub.queue.try_get(&old)) {
+        sub.stats.dropped++;
+        unref(old);
+      }
+    }
+    sub.stats.delivered++;
+  }
+  unref(entry);
+  return true;
+}
+
+const TSL2591Sample *TSL2591SampleBus::receive(int subscriber, Kernel::Clock::duration_u32 timeout) {
+  Entry *entry;
+  if (subscriber < 0 || (size_t)subscriber >= _count ||
+      !_subscribers[subscriber].queue.try_get_for(timeout, &entry)) {
+    return NULL;
+  }
+  return &entry->sample;
+}
+
+void TSL2591SampleBus::release(const TSL2591Sample *sample) {
+  if (sample) {
+    unref(reinterpret_cast<Entry *>(const_cast<TSL2591Sample *>(sample)));
+  }
+}
+
+TSL2591SubscriberStats TSL2591SampleBus::stats(int subscriber) const {
+  TSL2591SubscriberStats s;
+  memset(&s, 0, sizeof(s));
+  if (subscriber >= 0 && (size_t)subscriber < _count) {
+    s = _subscribers[subscriber].stats;
+  }
+  return s;
+}
+
+void TSL2591SampleBus::unref(Entry *entry) {
+  if (core_util_atomic_decr_u32(&entry->refs, 1) == 0) {
+    _pool.free(entry);
+  }
+}
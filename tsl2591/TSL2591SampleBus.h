@@ -0,0 +1,91 @@
+/* TSL2591 Digital Light Sensor, publish/subscribe distribution of samples */
+
+#ifndef TSL2591_SAMPLE_BUS_H
+#define TSL2591_SAMPLE_BUS_H
+
+#include "mbed.h"
+#include "TSL2591Sample.h"
+
+#ifndef TSL2591_BUS_MAX_SUBSCRIBERS
+#define TSL2591_BUS_MAX_SUBSCRIBERS (4)
+#endif
+// Depth of every subscriber queue
+#ifndef TSL2591_BUS_QUEUE_SIZE
+#define TSL2591_BUS_QUEUE_SIZE (4)
+#endif
+// Samples in flight: every queue full, one held by each receiver and the one being published
+#ifndef TSL2591_BUS_POOL_SIZE
+#define TSL2591_BUS_POOL_SIZE (TSL2591_BUS_MAX_SUBSCRIBERS * (TSL2591_BUS_QUEUE_SIZE + 1) + 1)
+#endif
+
+struct TSL2591SubscriberStats {
+  uint32_t delivered;   // queued for the subscriber
+  uint32_t dropped;     // oldest sample thrown out for a newer one
+};
+
+/**************************************************************************/
+/*
+    Hands every published sample to several consumers without copying
+    it. A sample is allocated once from a MemoryPool, a reference count
+    tracks how many subscriber queues and receivers still hold
+    it, the last release() frees it:
+
+      TSL2591SampleBus bus;
+      int logger = bus.subscribe();       // every sample
+      int display = bus.subscribe(10);    // every 10th sample
+
+      service.start(bus);
+
+      // in the logger thread
+      const TSL2591Sample *s = bus.receive(logger);
+      ... use *s ...
+      bus.release(s);
+
+    publish() never blocks: a full subscriber queue loses its oldest
+    sample to the new one (counted in stats().dropped), so a stalled
+    consumer only loses data itself and neither the acquisition nor the
+    other subscribers wait for it. If the pool is exhausted (consumers
+    hold on to more than one sample each) the new sample isn't published
+    at all, see poolExhausted(). Subscribe everybody before publishing
+    starts.
+*/
+/**************************************************************************/
+class TSL2591SampleBus {
+public:
+  TSL2591SampleBus(void);
+
+  /* Returns the subscriber id or -1 if all slots are taken */
+  int subscribe(uint16_t decimation = 1);
+
+  /* Producer side, returns false if the pool was exhausted */
+  bool publish(const TSL2591Sample &sample);
+
+  /* Next sample for the subscriber, NULL on timeout. Pass it to release() */
+  const TSL2591Sample *receive(int subscriber, Kernel::Clock::duration_u32 timeout = Kernel::wait_for_u32_forever);
+  void release(const TSL2591Sample *sample);
+
+  TSL2591SubscriberStats stats(int subscriber) const;
+  uint32_t poolExhausted(void) const { return _poolExhausted; }
+
+private:
+  struct Entry {
+    TSL2591Sample sample;   // first member, receive() returns its address
+    volatile uint32_t refs;
+  };
+
+  struct Subscriber {
+    Queue<Entry, TSL2591_BUS_QUEUE_SIZE> queue;
+    uint16_t decimation;
+    uint16_t phase;
+    TSL2591SubscriberStats stats;
+  };
+
+  void unref(Entry *entry);
+
+  MemoryPool<Entry, TSL2591_BUS_POOL_SIZE> _pool;
+  Subscriber _subscribers[TSL2591_BUS_MAX_SUBSCRIBERS];
+  size_t _count;
+  uint32_t _poolExhausted;
+};
+
+#endif
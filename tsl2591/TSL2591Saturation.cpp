@@ -0,0 +1,55 @@
+/* TSL2591 Digital Light Sensor, saturation detection and retry */
+
+#include "TSL2591Saturation.h"
+
+TSL2591Saturation::TSL2591Saturation(Adafruit_TSL2591 &tsl, TSL2591Registers &regs, uint8_t maxRetries)
+  : _tsl(tsl), _regs(regs), _maxRetries(maxRetries), _saturated(0), _retries(0) {
+}
+
+int TSL2591Saturation::read(TSL2591Sample &sample) {
+  const tsl2591Gain_t configuredGain = _tsl.getGain();
+  const tsl2591IntegrationTime_t configuredTiming = _tsl.getTiming();
+  tsl2591Gain_t gain = configuredGain;
+  tsl2591IntegrationTime_t timing = configuredTiming;
+  uint8_t retries = 0;
+  uint32_t lum;
+  int err;
+
+  while (true) {
+    err = _regs.readFullLuminosity(timing, lum);
+    if (err) {
+      break;
+    }
+    sample = TSL2591Sample::make(lum & 0xFFFF, lum >> 16, gain, timing);
+    if (!(sample.flags & TSL2591_SAMPLE_SATURATED) || retries >= _maxRetries) {
+      break;
+    }
+
+    // One step down, nothing left below 100 ms at low gain
+    if (timing != TSL2591_INTEGRATIONTIME_100MS) {
+      timing = TSL2591_INTEGRATIONTIME_100MS;
+    } else if (gain != TSL2591_GAIN_LOW) {
+      gain = (tsl2591Gain_t)(gain - TSL2591_GAIN_MED);
+    } else {
+      break;
+    }
+    err = _regs.setControl(gain, timing);
+    if (err) {
+      break;
+    }
+    retries++;
+    _retries++;
+  }
+
+  if (gain != configuredGain || timing != configuredTiming) {
+    int restore = _regs.setControl(configuredGain, configuredTiming);
+    err = err ? err : restore;
+  }
+  if (err == 0) {
+    sample.retries = retries;
+    if (sample.flags & TSL2591_SAMPLE_SATURATED) {
+      _saturated++;
+    }
+  }
+  return err;
+}
@@ -0,0 +1,49 @@
+/* TSL2591 Digital Light Sensor, saturation detection and retry */
+
+#ifndef TSL2591_SATURATION_H
+#define TSL2591_SATURATION_H
+
+#include "mbed.h"
+#include "Adafruit_TSL2591.h"
+#include "TSL2591Registers.h"
+#include "TSL2591Sample.h"
+
+/**************************************************************************/
+/*
+    Reads one sample like readFullLuminosity(), but a clipped conversion
+    (CH0 or CH1 at full scale for the integration time) is not returned
+    as a reading. It is repeated right away with less sensitivity, at
+    most maxRetries times:
+
+      - one step down is the most sensitive setting with 100 ms
+        integration below the current one, i.e. 100 ms at the same gain
+        first, then the next lower gain. The true level of a clipped
+        reading is unknown, the smallest step keeps the most resolution
+        and each retry only costs one short integration.
+
+    The sample records the settings it was taken with (lux stays right)
+    and the number of retries. If it is still clipped after the last
+    retry it carries TSL2591_SAMPLE_SATURATED. The configured gain and
+    timing are restored afterwards, the retries don't change the setup
+    (TSL2591AutoRange is the place for that).
+*/
+/**************************************************************************/
+class TSL2591Saturation {
+public:
+  TSL2591Saturation(Adafruit_TSL2591 &tsl, TSL2591Registers &regs, uint8_t maxRetries = 2);
+
+  /* I2C result, 0 on success */
+  int read(TSL2591Sample &sample);
+
+  uint32_t saturated(void) const { return _saturated; }
+  uint32_t retries(void) const { return _retries; }
+
+private:
+  Adafruit_TSL2591 &_tsl;
+  TSL2591Registers &_regs;
+  uint8_t _maxRetries;
+  uint32_t _saturated;
+  uint32_t _retries;
+};
+
+#endif
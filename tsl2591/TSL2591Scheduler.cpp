@@ -0,0 +1,149 @@
+/* TSL2591 Digital Light Sensor, pipelined readout of several sensors */
+
+#include "TSL2591Scheduler.h"
+
+TSL2591Scheduler::TSL2591Scheduler(EventQueue &queue, sample_callback_t onSample, uint8_t muxAddr)
+  : _queue(queue), _onSample(onSample), _muxAddr(muxAddr), _count(0),
+    _timing(TSL2591_INTEGRATIONTIME_100MS), _period(100) {
+}
+
+int TSL2591Scheduler::addSensor(Adafruit_TSL2591 &tsl, I2C &i2c, int muxChannel) {
+  if (_count >= TSL2591_SCHEDULER_MAX_SENSORS) {
+    return -1;
+  }
+  Slot &slot = _slots[_count];
+  slot.tsl = &tsl;
+  slot.i2c = &i2c;
+  slot.muxChannel = muxChannel;
+  slot.event = 0;
+  slot.lead = std::chrono::milliseconds(TSL2591_SCHEDULER_POLL_LEAD_MS);
+  return _count++;
+}
+
+int TSL2591Scheduler::selectChannel(size_t sensor) {
+  const Slot &slot = _slots[sensor];
+  if (slot.muxChannel < 0) {
+    return 0;
+  }
+  char mask = (char)(1 << slot.muxChannel);
+  return slot.i2c->write(_muxAddr << 1, &mask, 1);
+}
+
+/**************************************************************************/
+/*
+    Powers the sensors up one after the other, spaced by 1/N of the
+    integration time, so their conversions (and readouts) are staggered
+*/
+/**************************************************************************/
+bool TSL2591Scheduler::start(tsl2591IntegrationTime_t timing) {
+  if (_count == 0) {
+    return false;
+  }
+  for (size_t i = 0; i < _count; i++) {
+    if (_slots[i].tsl->getTiming() != timing) {
+      return false;
+    }
+  }
+  _timing = timing;
+  _period = std::chrono::milliseconds(100 * (timing + 1));
+  for (size_t i = 0; i < _count; i++) {
+    _slots[i].event = _queue.call_in(_period * i / _count, this, &TSL2591Scheduler::startSensor, i);
+  }
+  return true;
+}
+
+void TSL2591Scheduler::stop(void) {
+  for (size_t i = 0; i < _count; i++) {
+    _queue.cancel(_slots[i].event);
+    _slots[i].event = 0;
+    writeEnable(i, TSL2591_ENABLE_POWEROFF);
+  }
+}
+
+void TSL2591Scheduler::startSensor(size_t sensor) {
+  TSL2591Registers regs(*_slots[sensor].i2c);
+
+  // AINT marks the end of every conversion
+  int status = selectChannel(sensor);
+  if (status == 0) {
+    status = regs.write8(TSL2591_REGISTER_PERSIST_FILTER, TSL2591_PERSIST_EVERY);
+  }
+  if (status == 0) {
+    status = regs.command(TSL2591_CLEAR_INT);
+  }
+  if (status == 0) {
+    status = regs.write8(TSL2591_REGISTER_ENABLE, TSL2591_ENABLE_POWERON | TSL2591_ENABLE_AEN | TSL2591_ENABLE_AIEN);
+  }
+  if (status) {
+    _onSample(sensor, status, 0);
+    _slots[sensor].event = _queue.call_in(_period, this, &TSL2591Scheduler::startSensor, sensor);
+    return;
+  }
+  schedule(sensor, Kernel::Clock::now() + _period);
+}
+
+void TSL2591Scheduler::schedule(size_t sensor, Kernel::Clock::time_point expected) {
+  Slot &slot = _slots[sensor];
+  Kernel::Clock::time_point first = expected - slot.lead;
+  Kernel::Clock::time_point now = Kernel::Clock::now();
+
+  slot.expected = expected;
+  slot.firstPoll = true;
+  slot.event = _queue.call_in(first > now ? std::chrono::duration_cast<std::chrono::milliseconds>(first - now)
+                                          : std::chrono::milliseconds(0),
+                              this, &TSL2591Scheduler::poll, sensor);
+}
+
+/**************************************************************************/
+/*
+    Fetches the conversion that just completed, the ALS stays enabled and
+    is already integrating the next one. STATUS and C0DATAL..C1DATAH are
+    consecutive registers, one read tells whether it is a new one.
+*/
+/**************************************************************************/
+void TSL2591Scheduler::poll(size_t sensor) {
+  Slot &slot = _slots[sensor];
+  TSL2591Registers regs(*slot.i2c);
+  Kernel::Clock::time_point now = Kernel::Clock::now();
+  bool first = slot.firstPoll;
+  char data[5];
+
+  slot.firstPoll = false;
+  int status = selectChannel(sensor);
+  if (status == 0) {
+    status = regs.read(TSL2591_REGISTER_DEVICE_STATUS, data, sizeof(data));
+  }
+  if (status == 0 && !(data[0] & TSL2591_STATUS_AINT)) {
+    if (now < slot.expected + _period) {
+      // Not there yet, this sensor's oscillator is a bit slower
+      slot.event = _queue.call_in(std::chrono::milliseconds(TSL2591_SCHEDULER_POLL_MS),
+                                  this, &TSL2591Scheduler::poll, sensor);
+      return;
+    }
+    status = -1;
+  }
+  if (status == 0) {
+    // Done before the first look means it may have been done for a while
+    slot.lead = first ? slot.lead * 2 : slot.lead / 2;
+    if (slot.lead > _period / 2) {
+      slot.lead = _period / 2;
+    } else if (slot.lead < std::chrono::milliseconds(TSL2591_SCHEDULER_POLL_LEAD_MS)) {
+      slot.lead = std::chrono::milliseconds(TSL2591_SCHEDULER_POLL_LEAD_MS);
+    }
+    status = regs.command(TSL2591_CLEAR_INT);
+  }
+  _onSample(sensor, status, status ? 0 : TSL2591Registers::packChannels(&data[1]));
+
+  // The next conversion ends one period after this one, whenever that was
+  schedule(sensor, now + _period);
+}
+
+int TSL2591Scheduler::writeEnable(size_t sensor, uint8_t value) {
+  TSL2591Registers regs(*_slots[sensor].i2c);
+
+  int status = selectChannel(sensor);
+  if (status == 0) {
+    status = regs.write8(TSL2591_REGISTER_ENABLE, value);
+  }
+  return status;
+}
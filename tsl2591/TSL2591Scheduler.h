@@ -0,0 +1,116 @@
+/* TSL2591 Digital Light Sensor, pipelined readout of several sensors */
+
+#ifndef TSL2591_SCHEDULER_H
+#define TSL2591_SCHEDULER_H
+
+#include "mbed.h"
+#include "Adafruit_TSL2591.h"
+#include "TSL2591Registers.h"
+
+#ifndef TSL2591_SCHEDULER_MAX_SENSORS
+#define TSL2591_SCHEDULER_MAX_SENSORS (8)
+#endif
+
+// Default address of a TCA9548A style I2C mux
+#define TSL2591_SCHEDULER_MUX_ADDR (0x70)
+
+// A sensor is first polled this long before the expected end of its conversion, then every POLL_MS
+#ifndef TSL2591_SCHEDULER_POLL_LEAD_MS
+#define TSL2591_SCHEDULER_POLL_LEAD_MS (5)
+#endif
+#ifndef TSL2591_SCHEDULER_POLL_MS
+#define TSL2591_SCHEDULER_POLL_MS (1)
+#endif
+
+/**************************************************************************/
+/*
+    Runs several TSL2591s at once. Every sensor is left integrating
+    continuously (each has its own ADC), the scheduler only has to collect
+    the results. The sensors are started spread evenly over one
+    integration period, so while one sensor is read the others keep
+    integrating and the aggregate rate is N samples per integration time
+    instead of one.
+
+    Each sensor's own oscillator sets its pace, not the MCU timer: like
+    TSL2591Continuous the ALS interrupt is set to TSL2591_PERSIST_EVERY
+    and each sensor is polled on its own around the expected end of its
+    conversion. One 5 byte read returns STATUS and both channels, and the
+    sample is only taken once AINT says there is a new conversion. So no
+    conversion is read twice or skipped when the clocks drift apart: a
+    sensor that is already done at the first look is looked at earlier
+    from then on (the lead doubles, up to half a period, and shrinks back
+    once it is ahead again). AVALID can't be used, it stays set while AEN
+    is on. The INT pins are not needed.
+
+    All sensors have the fixed address 0x29, so they either sit on
+    different I2C peripherals or behind an I2C mux. For a mux pass the
+    channel to addSensor() and select it before calling anything on the
+    Adafruit_TSL2591 object (begin(), setGain(), ...):
+
+      I2C bus1(I2C_SDA, I2C_SCL);
+      I2C bus2(PB_11, PB_10);
+      Adafruit_TSL2591 tsl1(1), tsl2(2), tsl3(3);
+      TSL2591Scheduler sched(queue, onSample);
+
+      sched.addSensor(tsl1, bus1, 0);   // mux channel 0 on bus1
+      sched.addSensor(tsl2, bus1, 1);   // mux channel 1 on bus1
+      sched.addSensor(tsl3, bus2);      // bus2, no mux
+
+      sched.selectChannel(0); tsl1.begin(bus1);
+      sched.selectChannel(1); tsl2.begin(bus1);
+      tsl3.begin(bus2);
+      ...
+      sched.start(TSL2591_INTEGRATIONTIME_100MS);
+      queue.dispatch_forever();
+
+    All sensors must be configured with the integration time passed to
+    start(). The callback runs in the context of the event queue, lum is
+    packed like getFullLuminosity() does it, status is the I2C result
+    (0 on success, -1 if no conversion ended within two periods). After
+    an error the sensor is followed from the next conversion.
+*/
+/**************************************************************************/
+class TSL2591Scheduler {
+public:
+  typedef Callback<void(size_t sensor, int status, uint32_t lum)> sample_callback_t;
+
+  TSL2591Scheduler(EventQueue &queue, sample_callback_t onSample, uint8_t muxAddr = TSL2591_SCHEDULER_MUX_ADDR);
+
+  /* Returns the index of the sensor or -1 if there is no free slot */
+  int addSensor(Adafruit_TSL2591 &tsl, I2C &i2c, int muxChannel = -1);
+
+  /* Routes the bus of the given sensor to it, no-op without a mux */
+  int selectChannel(size_t sensor);
+
+  /* Fails if a sensor is configured with a different integration time */
+  bool start(tsl2591IntegrationTime_t timing);
+  void stop(void);
+
+  size_t count(void) const { return _count; }
+
+private:
+  struct Slot {
+    Adafruit_TSL2591 *tsl;
+    I2C *i2c;
+    int muxChannel;
+    int event;
+    Kernel::Clock::time_point expected;   // nominal end of the next conversion
+    std::chrono::milliseconds lead;        // first poll this much before expected
+    bool firstPoll;
+  };
+
+  void startSensor(size_t sensor);
+  void schedule(size_t sensor, Kernel::Clock::time_point expected);
+  void poll(size_t sensor);
+  int writeEnable(size_t sensor, uint8_t value);
+
+  EventQueue &_queue;
+  sample_callback_t _onSample;
+  uint8_t _muxAddr;
+  Slot _slots[TSL2591_SCHEDULER_MAX_SENSORS];
+  size_t _count;
+  tsl2591IntegrationTime_t _timing;
+  std::chrono::milliseconds _period;
+};
+
+#endif
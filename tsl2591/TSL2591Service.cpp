@@ -0,0 +1,234 @@
+/* TSL2591 Digital Light Sensor, periodic acquisition thread */
+
+#include "TSL2591Service.h"
+
+TSL2591Service::TSL2591Service(Adafruit_TSL2591 &tsl, TSL2591Registers &regs,
+                               Kernel::Clock::duration period, osPriority priority)
+  : _tsl(tsl), _regs(regs), _period(period), _gain(TSL2591_GAIN_MED), _timing(TSL2591_INTEGRATIONTIME_100MS),
+    _bus(NULL), _thread(priority, sizeof(_stack), _stack, "tsl2591") {
+  memset(&_stats, 0, sizeof(_stats));
+  memset(&_pending, 0, sizeof(_pending));
+}
+
+void TSL2591Service::start(sample_callback_t onSample) {
+  // Carries on with the configuration of the sensor, from now on changed through requests
+  _gain = _tsl.getGain();
+  _timing = _tsl.getTiming();
+  _onSample = onSample;
+  _thread.start(callback(this, &TSL2591Service::run));
+}
+
+void TSL2591Service::start(TSL2591SampleBus &bus) {
+  _bus = &bus;
+  start(callback(this, &TSL2591Service::publish));
+}
+
+void TSL2591Service::publish(const TSL2591Sample &sample) {
+  _bus->publish(sample);
+}
+
+TSL2591ServiceStats TSL2591Service::stats(void) {
+  _statsMutex.lock();
+  TSL2591ServiceStats s = _stats;
+  _statsMutex.unlock();
+  return s;
+}
+
+void TSL2591Service::resetStats(void) {
+  _statsMutex.lock();
+  memset(&_stats, 0, sizeof(_stats));
+  _statsMutex.unlock();
+}
+
+void TSL2591Service::setGain(tsl2591Gain_t gain) {
+  Request r = {};
+  r.mask = TSL2591_SERVICE_GAIN;
+  r.gain = gain;
+  request(r);
+}
+
+void TSL2591Service::setTiming(tsl2591IntegrationTime_t timing) {
+  Request r = {};
+  r.mask = TSL2591_SERVICE_TIMING;
+  r.timing = timing;
+  request(r);
+}
+
+void TSL2591Service::setControl(tsl2591Gain_t gain, tsl2591IntegrationTime_t timing) {
+  Request r = {};
+  r.mask = TSL2591_SERVICE_GAIN | TSL2591_SERVICE_TIMING;
+  r.gain = gain;
+  r.timing = timing;
+  request(r);
+}
+
+void TSL2591Service::registerInterrupt(uint16_t lowerThreshold, uint16_t upperThreshold, tsl2591Persist_t persist) {
+  Request r = {};
+  r.mask = TSL2591_SERVICE_THRESHOLDS | TSL2591_SERVICE_PERSIST;
+  r.lower = lowerThreshold;
+  r.upper = upperThreshold;
+  r.persist = persist;
+  request(r);
+}
+
+void TSL2591Service::setNoPersistThresholds(uint16_t lowerThreshold, uint16_t upperThreshold) {
+  Request r = {};
+  r.mask = TSL2591_SERVICE_NP_THRESHOLDS;
+  r.npLower = lowerThreshold;
+  r.npUpper = upperThreshold;
+  request(r);
+}
+
+uint8_t TSL2591Service::pending(void) {
+  CriticalSectionLock lock;
+  return _pending.mask;
+}
+
+/**************************************************************************/
+/*
+    Merges a request into the pending one, newer values replace older
+    ones. With keepNewer (failed writes put back) parts that were
+    requested again in the meantime are left alone.
+*/
+/**************************************************************************/
+void TSL2591Service::request(const Request &r, bool keepNewer) {
+  CriticalSectionLock lock;
+  uint8_t mask = keepNewer ? (r.mask & ~_pending.mask) : r.mask;
+  if (mask & TSL2591_SERVICE_GAIN) {
+    _pending.gain = r.gain;
+  }
+  if (mask & TSL2591_SERVICE_TIMING) {
+    _pending.timing = r.timing;
+  }
+  if (mask & TSL2591_SERVICE_THRESHOLDS) {
+    _pending.lower = r.lower;
+    _pending.upper = r.upper;
+  }
+  if (mask & TSL2591_SERVICE_NP_THRESHOLDS) {
+    _pending.npLower = r.npLower;
+    _pending.npUpper = r.npUpper;
+  }
+  if (mask & TSL2591_SERVICE_PERSIST) {
+    _pending.persist = r.persist;
+  }
+  _pending.mask |= mask;
+}
+
+/**************************************************************************/
+/*
+    Writes the pending changes, called between two samples. Returns true
+    if gain or timing changed.
+*/
+/**************************************************************************/
+bool TSL2591Service::applyRequests(void) {
+  Request r;
+  {
+    CriticalSectionLock lock;
+    r = _pending;
+    _pending.mask = 0;
+  }
+  if (r.mask == 0) {
+    return false;
+  }
+
+  uint8_t failed = 0;
+  bool changed = false;
+  if (r.mask & (TSL2591_SERVICE_GAIN | TSL2591_SERVICE_TIMING)) {
+    // Both in one CONTROL write, the part not requested stays as it is
+    tsl2591Gain_t gain = (r.mask & TSL2591_SERVICE_GAIN) ? (tsl2591Gain_t)r.gain : _gain;
+    tsl2591IntegrationTime_t timing = (r.mask & TSL2591_SERVICE_TIMING) ? (tsl2591IntegrationTime_t)r.timing : _timing;
+    if (_regs.setControl(gain, timing)) {
+      failed |= r.mask & (TSL2591_SERVICE_GAIN | TSL2591_SERVICE_TIMING);
+    } else {
+      changed = (gain != _gain || timing != _timing);
+      _gain = gain;
+      _timing = timing;
+    }
+  }
+  if ((r.mask & TSL2591_SERVICE_THRESHOLDS) && _regs.setThresholds(r.lower, r.upper)) {
+    failed |= TSL2591_SERVICE_THRESHOLDS;
+  }
+  if ((r.mask & TSL2591_SERVICE_NP_THRESHOLDS) && _regs.setNoPersistThresholds(r.npLower, r.npUpper)) {
+    failed |= TSL2591_SERVICE_NP_THRESHOLDS;
+  }
+  if ((r.mask & TSL2591_SERVICE_PERSIST) && _regs.setPersist((tsl2591Persist_t)r.persist)) {
+    failed |= TSL2591_SERVICE_PERSIST;
+  }
+
+  _statsMutex.lock();
+  if (r.mask & ~failed) {
+    _stats.reconfigs++;
+  }
+  if (failed) {
+    _stats.reconfigErrors++;
+  }
+  _statsMutex.unlock();
+
+  if (failed) {
+    r.mask = failed;
+    request(r, true);
+  }
+  return changed;
+}
+
+void TSL2591Service::run(void) {
+  Kernel::Clock::time_point deadline = Kernel::Clock::now();
+  bool reconfigured = false;
+
+  while (true) {
+    deadline += _period;
+    ThisThread::sleep_until(deadline);
+
+    Kernel::Clock::time_point start = Kernel::Clock::now();
+    uint32_t jitter = (start - deadline).count();
+    TSL2591_TRACE_POINT(TSL2591_TRACE_SERVICE_WAKE, 0, jitter);
+
+    // The shadow is dropped on bus errors, without it neither the
+    // settings below nor the CONTROL a recovery puts back are current
+    if (!_regs.valid()) {
+      _regs.resync();
+    }
+
+    // The ALS is off between two samples, no sample sees two configurations
+    reconfigured |= applyRequests();
+    if (_regs.valid()) {
+      // The settings in use, a recovery may have written CONTROL since
+      _gain = _regs.gain();
+      _timing = _regs.timing();
+    }
+
+    uint32_t lum = 0;
+    int err = _regs.readFullLuminosity(_timing, lum);
+
+    TSL2591Sample sample = TSL2591Sample::make(lum & 0xFFFF, lum >> 16, _gain, _timing);
+    sample.timestamp = (uint32_t)start.time_since_epoch().count();
+    if (err == 0 && reconfigured) {
+      sample.flags |= TSL2591_SAMPLE_RECONFIGURED;
+      reconfigured = false;
+    }
+
+    _statsMutex.lock();
+    if (err) {
+      _stats.errors++;
+    } else {
+      _stats.samples++;
+      _stats.jitterSumMs += jitter;
+      if (jitter > _stats.jitterMaxMs) {
+        _stats.jitterMaxMs = jitter;
+      }
+    }
+    _statsMutex.unlock();
+
+    if (err == 0 && _onSample) {
+      _onSample(sample);
+    }
+
+    // Checked after the callback, it eats from the same period
+    if (Kernel::Clock::now() >= deadline + _period) {
+      _statsMutex.lock();
+      _stats.overruns++;
+      _statsMutex.unlock();
+      deadline = Kernel::Clock::now();
+    }
+  }
+}
@@ -0,0 +1,128 @@
+/* TSL2591 Digital Light Sensor, periodic acquisition thread */
+
+#ifndef TSL2591_SERVICE_H
+#define TSL2591_SERVICE_H
+
+#include "mbed.h"
+#include "Adafruit_TSL2591.h"
+#include "TSL2591Registers.h"
+#include "TSL2591Sample.h"
+#include "TSL2591SampleBus.h"
+
+#ifndef TSL2591_SERVICE_STACK_SIZE
+#define TSL2591_SERVICE_STACK_SIZE (2048)
+#endif
+
+// Parts of a configuration request, gain and timing share the CONTROL write
+#define TSL2591_SERVICE_GAIN          (0x01)
+#define TSL2591_SERVICE_TIMING        (0x02)
+#define TSL2591_SERVICE_THRESHOLDS    (0x04)   // persisted interrupt window
+#define TSL2591_SERVICE_NP_THRESHOLDS (0x08)   // no-persist interrupt window
+#define TSL2591_SERVICE_PERSIST       (0x10)
+
+struct TSL2591ServiceStats {
+  uint32_t samples;
+  uint32_t errors;          // I2C errors, no sample delivered
+  uint32_t overruns;        // deadlines missed, schedule restarted
+  uint32_t jitterMaxMs;     // worst wake up after the deadline
+  uint32_t jitterSumMs;     // for the average: jitterSumMs / samples
+  uint32_t reconfigs;       // configuration requests applied
+  uint32_t reconfigErrors;  // failed register writes, tried again before the next sample
+};
+
+/**************************************************************************/
+/*
+    Runs the acquisition in its own thread (stack allocated with the
+    object) at a fixed sample rate. Each sample starts on an absolute
+    deadline (ThisThread::sleep_until on Kernel::Clock), so neither the
+    integration time nor the time the callback takes shift the schedule.
+    The timestamp of a sample is the start of its integration.
+
+    The period has to be longer than the conversion time of the
+    configured integration time plus the callback, otherwise deadlines
+    are missed: they are counted as overruns and the schedule restarts
+    from now instead of firing a burst of late samples. Jitter is the
+    delay between deadline and wake up, the resolution is the 1 ms
+    kernel tick.
+
+    The callback runs in the service thread, keep it short (push into a
+    TSL2591RingBuffer for example). To feed several consumers start it
+    with a TSL2591SampleBus instead, every sample is published there.
+
+    Gain, timing, interrupt thresholds and persist filter can be changed
+    while the service runs, from any thread or interrupt handler. The
+    requests only record the new values and return at once, later ones
+    overwrite earlier ones that weren't applied yet. The service thread
+    applies them between two samples, while the ALS is off: gain and
+    timing together in one CONTROL write, each threshold window in one
+    burst, through the register shadow so unchanged values cost nothing.
+    A sample is therefore taken either completely with the old or with
+    the new settings, the first one with new gain/timing is flagged
+    TSL2591_SAMPLE_RECONFIGURED. A change takes effect at most one
+    period after the request, a failed write is tried again before the
+    next sample.
+
+    Once started the service owns the sensor configuration: the cached
+    gain/timing of Adafruit_TSL2591 (getGain(), calculateLux()) don't
+    follow these changes, convert with the gain and timing of each
+    sample (TSL2591LuxTable, tsl2591MilliLux()). They are taken from the
+    register shadow before every sample, so they stay right when a bus
+    recovery (TSL2591Recovery) re-initialized the sensor.
+*/
+/**************************************************************************/
+class TSL2591Service {
+public:
+  typedef Callback<void(const TSL2591Sample &sample)> sample_callback_t;
+
+  TSL2591Service(Adafruit_TSL2591 &tsl, TSL2591Registers &regs, Kernel::Clock::duration period,
+                 osPriority priority = osPriorityAboveNormal);
+
+  void start(sample_callback_t onSample);
+  void start(TSL2591SampleBus &bus);
+
+  /* Copy of the counters, taken atomically against the service thread */
+  TSL2591ServiceStats stats(void);
+  void resetStats(void);
+
+  /* Configuration requests, applied before the next sample */
+  void setGain(tsl2591Gain_t gain);
+  void setTiming(tsl2591IntegrationTime_t timing);
+  void setControl(tsl2591Gain_t gain, tsl2591IntegrationTime_t timing);
+  void registerInterrupt(uint16_t lowerThreshold, uint16_t upperThreshold, tsl2591Persist_t persist);
+  void setNoPersistThresholds(uint16_t lowerThreshold, uint16_t upperThreshold);
+
+  /* TSL2591_SERVICE_* parts still waiting to be applied */
+  uint8_t pending(void);
+
+private:
+  struct Request {
+    uint8_t mask;         // TSL2591_SERVICE_*
+    uint8_t gain;
+    uint8_t timing;
+    uint8_t persist;
+    uint16_t lower;
+    uint16_t upper;
+    uint16_t npLower;
+    uint16_t npUpper;
+  };
+
+  void run(void);
+  void publish(const TSL2591Sample &sample);
+  void request(const Request &r, bool keepNewer = false);
+  bool applyRequests(void);
+
+  Adafruit_TSL2591 &_tsl;
+  TSL2591Registers &_regs;
+  Kernel::Clock::duration _period;
+  tsl2591Gain_t _gain;
+  tsl2591IntegrationTime_t _timing;
+  Request _pending;
+  sample_callback_t _onSample;
+  TSL2591SampleBus *_bus;
+  TSL2591ServiceStats _stats;
+  Mutex _statsMutex;
+  MBED_ALIGN(8) unsigned char _stack[TSL2591_SERVICE_STACK_SIZE];
+  Thread _thread;
+};
+
+#endif
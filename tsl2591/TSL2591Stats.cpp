@@ -0,0 +1,116 @@
+/* TSL2591 Digital Light Sensor, streaming window statistics */
+
+#include "TSL2591Stats.h"
+#include <math.h>
+
+void TSL2591RunningStat::add(float x) {
+  n++;
+  if (n == 1) {
+    min = max = x;
+  } else {
+    if (x < min) {
+      min = x;
+    }
+    if (x > max) {
+      max = x;
+    }
+  }
+  float delta = x - mean;
+  mean += delta / n;
+  m2 += delta * (x - mean);
+}
+
+float TSL2591RunningStat::stddev(void) const {
+  return sqrtf(variance());
+}
+
+TSL2591Stats::TSL2591Stats(float ewmaAlpha)
+  : _alpha(ewmaAlpha), _ewmaValid(false) {
+  memset(&_summary, 0, sizeof(_summary));
+  memset(_histogram, 0, sizeof(_histogram));
+}
+
+void TSL2591Stats::add(uint16_t full, uint16_t ir, float lux) {
+  _summary.count++;
+  _summary.full.add(full);
+  _summary.ir.add(ir);
+
+  if (lux < 0) {
+    _summary.overflows++;
+    return;
+  }
+  _summary.lux.add(lux);
+
+  if (_ewmaValid) {
+    _summary.luxEwma += _alpha * (lux - _summary.luxEwma);
+  } else {
+    _summary.luxEwma = lux;
+    _ewmaValid = true;
+  }
+
+  int b = bin(lux);
+  if (_histogram[b] < 0xFFFF) {
+    _histogram[b]++;
+  }
+}
+
+TSL2591StatsSummary TSL2591Stats::flush(void) {
+  TSL2591StatsSummary s = _summary;
+  s.luxP50 = percentile(0.50f);
+  s.luxP90 = percentile(0.90f);
+  s.luxP99 = percentile(0.99f);
+
+  float ewma = _summary.luxEwma;
+  memset(&_summary, 0, sizeof(_summary));
+  memset(_histogram, 0, sizeof(_histogram));
+  _summary.luxEwma = ewma;
+  return s;
+}
+
+float TSL2591Stats::percentile(float fraction) const {
+  uint32_t total = 0;
+  for (int i = 0; i < TSL2591_STATS_BINS; i++) {
+    total += _histogram[i];
+  }
+  if (total == 0) {
+    return 0.0f;
+  }
+
+  float rank = fraction * total;
+  uint32_t below = 0;
+  for (int i = 0; i < TSL2591_STATS_BINS; i++) {
+    if (_histogram[i] && below + _histogram[i] >= rank) {
+      // Outer bins are open, clamp to the observed extremes
+      float lo = (i == 0) ? _summary.lux.min : binLower(i);
+      float hi = (i == TSL2591_STATS_BINS - 1) ? _summary.lux.max : binLower(i + 1);
+      if (lo < _summary.lux.min) {
+        lo = _summary.lux.min;
+      }
+      if (hi > _summary.lux.max) {
+        hi = _summary.lux.max;
+      }
+      float f = (rank - below) / _histogram[i];
+      return lo + f * (hi - lo);
+    }
+    below += _histogram[i];
+  }
+  return _summary.lux.max;
+}
+
+int TSL2591Stats::bin(float lux) const {
+  if (lux <= 0) {
+    return 0;
+  }
+  int b = (int)floorf((log10f(lux) - TSL2591_STATS_MIN_DECADE) * TSL2591_STATS_BINS_PER_DECADE) + 1;
+  if (b < 0) {
+    return 0;
+  }
+  if (b > TSL2591_STATS_BINS - 1) {
+    return TSL2591_STATS_BINS - 1;
+  }
+  return b;
+}
+
+float TSL2591Stats::binLower(int bin) const {
+  return powf(10.0f, TSL2591_STATS_MIN_DECADE + (float)(bin - 1) / TSL2591_STATS_BINS_PER_DECADE);
+}
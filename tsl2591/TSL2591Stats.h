@@ -0,0 +1,84 @@
+/* TSL2591 Digital Light Sensor, streaming window statistics */
+
+#ifndef TSL2591_STATS_H
+#define TSL2591_STATS_H
+
+#include "mbed.h"
+
+// Log spaced lux histogram: TSL2591_STATS_BINS_PER_DECADE bins per decade
+// from 10^TSL2591_STATS_MIN_DECADE lux up, plus one bin below and above
+#ifndef TSL2591_STATS_BINS_PER_DECADE
+#define TSL2591_STATS_BINS_PER_DECADE (8)
+#endif
+#define TSL2591_STATS_MIN_DECADE  (-3)
+#define TSL2591_STATS_DECADES     (8)
+#define TSL2591_STATS_BINS        (TSL2591_STATS_DECADES * TSL2591_STATS_BINS_PER_DECADE + 2)
+
+/**************************************************************************/
+/*
+    Running mean/variance (Welford), min and max of one value
+*/
+/**************************************************************************/
+struct TSL2591RunningStat {
+  uint32_t n;
+  float mean;
+  float m2;
+  float min;
+  float max;
+
+  void reset(void) { n = 0; mean = 0; m2 = 0; min = 0; max = 0; }
+  void add(float x);
+  float variance(void) const { return (n > 1) ? m2 / (n - 1) : 0.0f; }
+  float stddev(void) const;
+};
+
+struct TSL2591StatsSummary {
+  uint32_t count;
+  uint32_t overflows;         // saturated samples, not in the lux statistics
+  TSL2591RunningStat full;
+  TSL2591RunningStat ir;
+  TSL2591RunningStat lux;
+  float luxEwma;              // carries over from window to window
+  float luxP50;               // from the histogram, see below
+  float luxP90;
+  float luxP99;
+};
+
+/**************************************************************************/
+/*
+    Constant memory statistics over the sample stream, for sending window
+    summaries upstream instead of every reading. add() the same CH0/CH1/
+    lux values the examples print, flush() at the end of a window returns
+    the summary and starts the next window.
+
+    Percentiles come from a log spaced histogram (TSL2591_STATS_BINS_PER_
+    DECADE bins per decade, 1 mlux to 100 klux), interpolated inside the
+    bin, so the result is within one bin (a factor of 1.33 at 8 bins per
+    decade) of the exact percentile.
+*/
+/**************************************************************************/
+class TSL2591Stats {
+public:
+  TSL2591Stats(float ewmaAlpha = 0.1f);
+
+  /* lux < 0 is calculateLux()'s overflow marker, the sample is only counted */
+  void add(uint16_t full, uint16_t ir, float lux);
+
+  uint32_t count(void) const { return _summary.count; }
+
+  TSL2591StatsSummary flush(void);
+
+  /* Value below which the given fraction (0..1) of the window's lux values are */
+  float percentile(float fraction) const;
+
+private:
+  int bin(float lux) const;
+  float binLower(int bin) const;
+
+  float _alpha;
+  bool _ewmaValid;
+  TSL2591StatsSummary _summary;
+  uint16_t _histogram[TSL2591_STATS_BINS];
+};
+
+#endif
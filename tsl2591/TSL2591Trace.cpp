@@ -0,0 +1,130 @@
+/* TSL2591 Digital Light Sensor, trace points of the driver hot paths */
+
+#include "TSL2591Trace.h"
+
+#if TSL2591_TRACE
+
+MBED_STATIC_ASSERT((TSL2591_TRACE_SIZE & (TSL2591_TRACE_SIZE - 1)) == 0, "TSL2591_TRACE_SIZE must be a power of two");
+
+static TSL2591TraceRecord traceBuffer[TSL2591_TRACE_SIZE];
+static volatile uint32_t traceHead;
+static uint32_t traceTail;
+
+#if defined(DWT) && (__CORTEX_M >= 3)
+#define TRACE_UNIT_HZ (SystemCoreClock)
+
+void tsl2591TraceInit(void) {
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+#if (__CORTEX_M == 7)
+  // The DWT of the M7 ignores writes until it is unlocked
+  DWT->LAR = 0xC5ACCE55;
+#endif
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+static inline uint32_t traceClock(void) {
+  return DWT->CYCCNT;
+}
+#else
+#define TRACE_UNIT_HZ (1000000)
+
+void tsl2591TraceInit(void) {
+}
+
+static inline uint32_t traceClock(void) {
+  return us_ticker_read();
+}
+#endif
+
+#if (TSL2591_TRACE_ITM_PORT >= 0) && defined(ITM)
+static inline void traceItm(const uint32_t *words) {
+  // Only if a probe turned the port on, and never wait for a full FIFO
+  if ((ITM->TCR & ITM_TCR_ITMENA_Msk) == 0 || (ITM->TER & (1UL << TSL2591_TRACE_ITM_PORT)) == 0) {
+    return;
+  }
+  for (int i = 0; i < 2; i++) {
+    if (ITM->PORT[TSL2591_TRACE_ITM_PORT].u32 == 0) {
+      return;
+    }
+    ITM->PORT[TSL2591_TRACE_ITM_PORT].u32 = words[i];
+  }
+}
+#else
+static inline void traceItm(const uint32_t *) {
+}
+#endif
+
+void tsl2591TracePoint(uint8_t event, uint8_t reg, uint16_t arg) {
+  // The slot is reserved atomically, ISRs and threads can trace at the same time
+  uint32_t slot = core_util_atomic_incr_u32(&traceHead, 1) - 1;
+  TSL2591TraceRecord &r = traceBuffer[slot & (TSL2591_TRACE_SIZE - 1)];
+  r.cycles = traceClock();
+  r.event = event;
+  r.reg = reg;
+  r.arg = arg;
+  traceItm((const uint32_t *)&r);
+}
+
+static size_t copyRecords(uint32_t &tail, TSL2591TraceRecord *out, size_t max) {
+  uint32_t head = core_util_atomic_load_u32(&traceHead);
+  if (head - tail > TSL2591_TRACE_SIZE) {
+    // Overwritten, only the last TSL2591_TRACE_SIZE are left
+    tail = head - TSL2591_TRACE_SIZE;
+  }
+  size_t n = 0;
+  for (; tail != head && n < max; tail++, n++) {
+    out[n] = traceBuffer[tail & (TSL2591_TRACE_SIZE - 1)];
+  }
+  return n;
+}
+
+size_t tsl2591TraceSnapshot(TSL2591TraceRecord *out, size_t max) {
+  uint32_t tail = traceTail;
+  return copyRecords(tail, out, max);
+}
+
+static const char *eventName(uint8_t event) {
+  static const char *const names[] = {
+    "?", "read", "read done", "write", "write done", "command", "command done",
+    "adc wait", "adc ready", "isr", "isr done", "retry", "recovery", "recovery done", "service wake"
+  };
+  return event < sizeof(names) / sizeof(names[0]) ? names[event] : names[0];
+}
+
+void tsl2591TraceDump(void) {
+  static TSL2591TraceRecord records[32];
+  uint32_t perUs = TRACE_UNIT_HZ / 1000000;
+  uint32_t last = 0;
+  bool first = true;
+  size_t n;
+
+  printf("Trace (%lu per us):\n", (unsigned long)perUs);
+  while ((n = copyRecords(traceTail, records, sizeof(records) / sizeof(records[0]))) > 0) {
+    for (size_t i = 0; i < n; i++) {
+      const TSL2591TraceRecord &r = records[i];
+      uint32_t delta = first ? 0 : (r.cycles - last) / perUs;
+      printf("%10lu  +%8lu us  %-14s reg %02x  %u\n", (unsigned long)r.cycles, (unsigned long)delta,
+             eventName(r.event), r.reg, r.arg);
+      last = r.cycles;
+      first = false;
+    }
+  }
+}
+
+#else
+
+void tsl2591TraceInit(void) {
+}
+
+void tsl2591TracePoint(uint8_t, uint8_t, uint16_t) {
+}
+
+size_t tsl2591TraceSnapshot(TSL2591TraceRecord *, size_t) {
+  return 0;
+}
+
+void tsl2591TraceDump(void) {
+}
+
+#endif
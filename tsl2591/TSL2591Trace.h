@@ -0,0 +1,81 @@
+/* TSL2591 Digital Light Sensor, trace points of the driver hot paths */
+
+#ifndef TSL2591_TRACE_H
+#define TSL2591_TRACE_H
+
+#include "mbed.h"
+
+// Compiled out unless enabled, set "trace": true in mbed_app.json
+#ifndef TSL2591_TRACE
+#ifdef MBED_CONF_APP_TRACE
+#define TSL2591_TRACE MBED_CONF_APP_TRACE
+#else
+#define TSL2591_TRACE 0
+#endif
+#endif
+
+// Records kept in RAM (8 bytes each), a power of two
+#ifndef TSL2591_TRACE_SIZE
+#define TSL2591_TRACE_SIZE (256)
+#endif
+
+// ITM stimulus port the records are mirrored to, -1 for none
+#ifndef TSL2591_TRACE_ITM_PORT
+#define TSL2591_TRACE_ITM_PORT (1)
+#endif
+
+enum tsl2591TraceEvent_t {
+  TSL2591_TRACE_READ_BEGIN = 1,   // reg, arg = length
+  TSL2591_TRACE_READ_END,         // reg, arg = I2C result
+  TSL2591_TRACE_WRITE_BEGIN,      // reg, arg = length
+  TSL2591_TRACE_WRITE_END,        // reg, arg = I2C result
+  TSL2591_TRACE_COMMAND_BEGIN,    // reg = special function
+  TSL2591_TRACE_COMMAND_END,      // arg = I2C result
+  TSL2591_TRACE_WAIT_BEGIN,       // ADC wait, reg = timing, arg = ms
+  TSL2591_TRACE_WAIT_END,
+  TSL2591_TRACE_ISR_BEGIN,        // arg = event
+  TSL2591_TRACE_ISR_END,
+  TSL2591_TRACE_RETRY,            // reg, arg = attempt
+  TSL2591_TRACE_RECOVERY_BEGIN,
+  TSL2591_TRACE_RECOVERY_END,     // arg = result
+  TSL2591_TRACE_SERVICE_WAKE,     // arg = jitter in ms
+};
+
+struct TSL2591TraceRecord {
+  uint32_t cycles;      // DWT cycle counter, us ticker on cores without DWT
+  uint8_t event;
+  uint8_t reg;
+  uint16_t arg;
+};
+
+/**************************************************************************/
+/*
+    Trace points in the register access, the ADC wait and the interrupt
+    paths. Each one stores an 8 byte record with a cycle timestamp in a
+    RAM ring of the last TSL2591_TRACE_SIZE records (a few dozen cycles
+    each, usable from ISRs) and mirrors it to an ITM stimulus port if a
+    debug probe has enabled the port, so it can be streamed over SWO.
+    Without a probe the ITM write is skipped, never waited for.
+
+    With TSL2591_TRACE 0 (the default) TSL2591_TRACE_POINT() expands to
+    nothing and the hot paths are exactly what they were.
+*/
+/**************************************************************************/
+#if TSL2591_TRACE
+#define TSL2591_TRACE_POINT(event, reg, arg) tsl2591TracePoint((event), (reg), (arg))
+#else
+#define TSL2591_TRACE_POINT(event, reg, arg) do { } while (0)
+#endif
+
+/* Starts the cycle counter, call once before the first trace point */
+void tsl2591TraceInit(void);
+
+void tsl2591TracePoint(uint8_t event, uint8_t reg, uint16_t arg);
+
+/* Copies up to max records, oldest first, returns the number copied */
+size_t tsl2591TraceSnapshot(TSL2591TraceRecord *out, size_t max);
+
+/* Prints the buffer with the time since the previous record and clears it */
+void tsl2591TraceDump(void);
+
+#endif
@@ -18,6 +18,10 @@ set exp=debug
 rem set exp=develop
 rem set exp=release
 
+rem minimal footprint profile instead of mbed_app.json
+set appconfig=
+rem set appconfig=mbed_app_minimal.json
+
 rem +++++++++++++++++++++++++++
 rem +++++++ config ende +++++++
 
@@ -32,8 +36,14 @@ echo:"Mbed OS:   "%mbedos%
 echo:"Plattform: "%platform%
 echo:"IDE:       "%ide%
 
+set appconfigopt=
+if defined appconfig (
+   echo:"Config:    "%appconfig%
+   set appconfigopt=--app-config .\%prj%\%appconfig%
+)
+
 mbed config -G MBED_OS_DIR %projectpath%\..\%mbedos%
-mbed export -v -m %platform% -i %ide% --source .\%prj% --source ..\%mbedos%
+mbed export -v -m %platform% -i %ide% --source .\%prj% --source ..\%mbedos% %appconfigopt%
 
 cd .\%prj%
 pause 
\ No newline at end of file
@@ -4,6 +4,89 @@
 
 #include "mbed.h"
 #include "Adafruit_TSL2591.h"
+#include "TSL2591Registers.h"
+#if MBED_CONF_APP_FIXED_POINT_LUX
+#include "TSL2591FixedLux.h"
+#endif
+#if MBED_CONF_APP_AUTO_RANGE
+#include "TSL2591AutoRange.h"
+#endif
+#if MBED_CONF_APP_FIXED_CONFIG
+#include "TSL2591FixedConfig.h"
+#if MBED_CONF_APP_AUTO_RANGE
+#error "fixed-config and auto-range can't be used together"
+#endif
+#endif
+#include "TSL2591Sample.h"
+#if MBED_CONF_APP_BUS_RECOVERY
+#include "TSL2591Recovery.h"
+#endif
+#if MBED_CONF_APP_SAMPLE_LOG
+#include "TSL2591Logger.h"
+#endif
+#if MBED_CONF_APP_DATA_READY && MBED_CONF_APP_DATA_READY_INT && !MBED_CONF_APP_CONTINUOUS
+#include "TSL2591DataReady.h"
+#endif
+#if MBED_CONF_APP_CONTINUOUS
+#include "TSL2591Continuous.h"
+#endif
+#if MBED_CONF_APP_SAMPLE_BUFFER
+#include "TSL2591RingBuffer.h"
+#endif
+#if MBED_CONF_APP_BINARY_STREAM
+#include "TSL2591BinaryStream.h"
+#endif
+#if MBED_CONF_APP_DUTY_CYCLE
+#include "TSL2591DutyCycle.h"
+#endif
+#if MBED_CONF_APP_SERVICE
+#include "TSL2591Service.h"
+#endif
+#if MBED_CONF_APP_SAMPLE_BUS && !MBED_CONF_APP_SERVICE
+#error "sample-bus distributes the samples of the service, set service too"
+#endif
+#if MBED_CONF_APP_SERVICE_COMMANDS && !MBED_CONF_APP_SERVICE
+#error "service-commands reconfigures the service, set service too"
+#endif
+#if MBED_CONF_APP_SERVICE_COMMANDS && MBED_CONF_APP_FIXED_CONFIG
+#error "fixed-config and service-commands can't be used together"
+#endif
+#if MBED_CONF_APP_STATS_WINDOW
+#include "TSL2591Stats.h"
+#endif
+#if MBED_CONF_APP_FEATURES_WINDOW
+#include "TSL2591Features.h"
+#if MBED_CONF_APP_STATS_WINDOW
+#error "stats-window and features-window can't be used together"
+#endif
+#endif
+#if MBED_CONF_APP_STATS_WINDOW || MBED_CONF_APP_BLOCK_FILTER || !MBED_CONF_APP_FIXED_POINT_LUX
+#include "TSL2591LuxTable.h"
+#endif
+#if MBED_CONF_APP_SATURATION_RETRIES
+#include "TSL2591Saturation.h"
+#endif
+#if MBED_CONF_APP_FOOTPRINT_REPORT
+#include "TSL2591Footprint.h"
+#endif
+#if MBED_CONF_APP_BLOCK_FILTER
+#include "TSL2591Block.h"
+#if !MBED_CONF_APP_SAMPLE_BUFFER
+#error "block-filter works on the sample buffer, set sample-buffer too"
+#endif
+#endif
+#if MBED_CONF_APP_SCHEDULER
+#include "TSL2591Scheduler.h"
+#if MBED_CONF_APP_ASYNC_READ
+#error "scheduler and async-read can't be used together"
+#endif
+#endif
+#if MBED_CONF_APP_ASYNC_READ
+#include "TSL2591AsyncReader.h"
+#if !DEVICE_I2C_ASYNCH
+#error "async-read needs a target with asynchronous I2C (DEVICE_I2C_ASYNCH)"
+#endif
+#endif
 
 // Example for demonstrating the TSL2591 library - public domain!
 
@@ -15,12 +98,139 @@ I2C i2c(I2C_SDA , I2C_SCL );
 
 Adafruit_TSL2591 tsl = Adafruit_TSL2591(2591); // pass in a number for the sensor identifier (for your use later)
 
+// Register level access for the burst read of both channels
+TSL2591Registers regs(i2c);
+
+#if MBED_CONF_APP_BUS_RECOVERY
+// Unlocks the bus and re-initializes the sensor when retries don't help
+TSL2591Recovery recovery(tsl, regs, I2C_SDA, I2C_SCL);
+#endif
+
+#if MBED_CONF_APP_DATA_READY && MBED_CONF_APP_DATA_READY_INT && !MBED_CONF_APP_CONTINUOUS
+// Reads start on the INT pin at the end of each conversion
+TSL2591DataReady dataReady(regs, MBED_CONF_APP_DATA_READY_PIN);
+#endif
+
+#if MBED_CONF_APP_CONTINUOUS
+// Back to back conversions, every one of them is read. With data-ready-int
+// the INT pin marks the end of a conversion, otherwise STATUS is polled
+#if MBED_CONF_APP_DATA_READY_INT
+InterruptIn continuousInt(MBED_CONF_APP_DATA_READY_PIN, PullUp);
+TSL2591Continuous continuous(tsl, regs, &continuousInt);
+#else
+TSL2591Continuous continuous(tsl, regs);
+#endif
+#endif
+
+#if MBED_CONF_APP_FIXED_CONFIG
+// Gain and integration time are compile time constants, see mbed_app.json
+typedef TSL2591FixedConfig<MBED_CONF_APP_FIXED_GAIN, MBED_CONF_APP_FIXED_TIMING> SensorConfig;
+#endif
+
+#if MBED_CONF_APP_AUTO_RANGE
+// Starts from the settings in configureSensor() and adapts them to the light level
+TSL2591AutoRange autoRange(regs);
+#endif
+
+// Threads that print samples, printf() of a float alone takes more than 1 kB
+#ifndef TSL2591_OUTPUT_STACK_SIZE
+#define TSL2591_OUTPUT_STACK_SIZE (2048)
+#endif
+
+#if MBED_CONF_APP_SAMPLE_BUFFER
+// Decouples acquisition from the (slow) console: the sensor side only pushes
+TSL2591RingBuffer<TSL2591Sample, 64> samples;
+
+MBED_ALIGN(8) unsigned char consumerStack[TSL2591_OUTPUT_STACK_SIZE];
+Thread consumer(osPriorityBelowNormal, sizeof(consumerStack), consumerStack, "tsl2591 out");
+#endif
+
+#if MBED_CONF_APP_BINARY_STREAM
+// Samples go out as 18 byte frames, decode them with tools/tsl2591_decode.py
+TSL2591BinaryStream stream(MBED_CONF_APP_BINARY_STREAM_TX, MBED_CONF_APP_BINARY_STREAM_RX);
+#endif
+
+#if MBED_CONF_APP_SAMPLE_LOG
+// Every sample is logged to the default block device (SD card or QSPI flash,
+// add the "SD" or "QSPIF" component for the target), read it with tools/tsl2591_log.py
+TSL2591Logger logger(*BlockDevice::get_default_instance(), 0, MBED_CONF_APP_SAMPLE_LOG_SIZE_KB * 1024ULL);
+#endif
+
+#if MBED_CONF_APP_DUTY_CYCLE
+// Sensor on for one integration per sample, deep sleep in between
+TSL2591DutyCycle dutyCycle(tsl, regs, std::chrono::milliseconds(MBED_CONF_APP_DUTY_CYCLE_PERIOD_MS));
+#endif
+
+#if MBED_CONF_APP_SERVICE
+// Acquisition thread with a fixed sample rate
+TSL2591Service service(tsl, regs, std::chrono::milliseconds(MBED_CONF_APP_SERVICE_PERIOD_MS));
+#endif
+
+#if MBED_CONF_APP_SAMPLE_BUS
+// Two consumers of the same samples: the usual output and a decimated one in main
+TSL2591SampleBus bus;
+int outputId;
+int decimatedId;
+
+MBED_ALIGN(8) unsigned char subscriberStack[TSL2591_OUTPUT_STACK_SIZE];
+Thread subscriber(osPriorityBelowNormal, sizeof(subscriberStack), subscriberStack, "tsl2591 sub");
+#endif
+
+#if MBED_CONF_APP_STATS_WINDOW
+// Only window summaries are sent, not every sample
+TSL2591Stats stats;
+#endif
+
+#if MBED_CONF_APP_FEATURES_WINDOW
+// Only a feature vector per window is sent, for classifying the light source
+TSL2591Features features;
+#endif
+
+#if MBED_CONF_APP_STATS_WINDOW || MBED_CONF_APP_BLOCK_FILTER || !MBED_CONF_APP_FIXED_POINT_LUX
+// Converts with the gain/timing stored in each sample, not the current one
+TSL2591LuxTable luxTable;
+#endif
+
+#if MBED_CONF_APP_SATURATION_RETRIES
+// A clipped reading is taken again at once with less sensitivity
+TSL2591Saturation saturation(tsl, regs, MBED_CONF_APP_SATURATION_RETRIES);
+#endif
+
+#if MBED_CONF_APP_BLOCK_FILTER
+// The consumer converts and low pass filters whole blocks of samples
+TSL2591Block block;
+TSL2591Biquad lowpass = TSL2591Biquad::lowpass(MBED_CONF_APP_BLOCK_FILTER_CUTOFF_PERCENT / 100.0F);
+#endif
+
+#if MBED_CONF_APP_ASYNC_READ || MBED_CONF_APP_SCHEDULER
+// The event buffer is static too, EventQueue would otherwise allocate it
+unsigned char queueBuffer[8 * EVENTS_EVENT_SIZE];
+EventQueue queue(sizeof(queueBuffer), queueBuffer);
+#endif
+
+#if MBED_CONF_APP_ASYNC_READ
+TSL2591AsyncReader asyncReader(tsl, i2c, queue);
+#endif
+
+#if MBED_CONF_APP_SCHEDULER
+// Follows the conversions of the sensor, more of them (behind a mux or on
+// other I2C buses) are added with addSensor() and read in turn
+void scheduledSample(size_t sensor, int status, uint32_t lum);
+TSL2591Scheduler scheduler(queue, scheduledSample);
+#endif
+
 /**************************************************************************/
 /*
     Configures the gain and integration time for the TSL2591
 */
 /**************************************************************************/
 void configureSensor(void) {
+#if MBED_CONF_APP_FIXED_CONFIG
+  SensorConfig::apply(tsl);
+
+  printf("------------------------------------\n");
+  printf("Gain:         %s\n", SensorConfig::gainName());
+#else
   // You can change the gain on the fly, to adapt to brighter/dimmer light situations
   //tsl.setGain(TSL2591_GAIN_LOW);    // 1x gain (bright light)
   tsl.setGain(TSL2591_GAIN_MED);      // 25x gain
@@ -53,6 +263,12 @@ void configureSensor(void) {
       printf("9876x (Max)\n");
       break;
   }
+#endif
+
+  /* Load the register shadow, configuration reads are served from RAM from now on */
+  if (regs.resync() == 0) {
+    printf("Timing:       %d ms\n", 100 * (regs.timing() + 1));
+  }
   printf("------------------------------------\n");
 }
 
@@ -73,6 +289,201 @@ void simpleRead(void) {
   printf("Luminosity: %d\n", x);
 }
 
+/**************************************************************************/
+/*
+    Lux of a sample, with the gain/timing it was taken with (a less
+    sensitive retry, settings changed by auto range or the service) and
+    not the ones tsl has cached. With fixed-point-lux set in milli lux
+    and without any floating point.
+*/
+/**************************************************************************/
+#if MBED_CONF_APP_FIXED_POINT_LUX
+uint32_t sampleMilliLux(const TSL2591Sample &s) {
+#if MBED_CONF_APP_FIXED_CONFIG
+  if (s.gain == SensorConfig::gain() && s.timing == SensorConfig::timing()) {
+    return SensorConfig::milliLux(s.full, s.ir);
+  }
+#endif
+  return tsl2591MilliLux(s.full, s.ir, (tsl2591Gain_t)s.gain, (tsl2591IntegrationTime_t)s.timing);
+}
+#else
+float sampleLux(const TSL2591Sample &s) {
+#if MBED_CONF_APP_FIXED_CONFIG
+  if (s.gain == SensorConfig::gain() && s.timing == SensorConfig::timing()) {
+    return SensorConfig::lux(s.full, s.ir);
+  }
+#endif
+  return TSL2591LuxTable::lux(s.full, s.ir, luxTable.factor(s.gain, s.timing));
+}
+#endif
+
+/**************************************************************************/
+/*
+    Prints one IR/Full Spectrum sample
+*/
+/**************************************************************************/
+void printSample(const TSL2591Sample &s) {
+#if MBED_CONF_APP_FIXED_POINT_LUX
+  char lux[16];
+  tsl2591FormatMilliLux(lux, sizeof(lux), sampleMilliLux(s));
+  printf("IR: %d  Full: %d  Visible: %d  Lux: %s", s.ir, s.full, s.full-s.ir, lux);
+#else
+  printf("IR: %d  Full: %d  Visible: %d  Lux: %f", s.ir, s.full, s.full-s.ir, sampleLux(s));
+#endif
+  if (s.retries) {
+    printf("  (%u retries)", s.retries);
+  }
+  printf("\n");
+}
+
+#if MBED_CONF_APP_FEATURES_WINDOW
+unsigned long q16PerMille(uint16_t q) {
+  return ((unsigned long)q * 1000 + 32767) / 65535;
+}
+#endif
+
+/**************************************************************************/
+/*
+    Sends a sample to the host, as binary frame with binary-stream set or
+    as text line. With
+    stats-window set only a summary of every window is sent, with
+    features-window the feature vector of every window (Q0.16 values
+    printed in per mille, the histogram in percent).
+*/
+/**************************************************************************/
+void outputSample(const TSL2591Sample &s) {
+#if MBED_CONF_APP_STATS_WINDOW
+  float lux;
+  luxTable.calculateLux(&s, &lux, 1);
+  stats.add(s.full, s.ir, lux);
+  if (stats.count() >= MBED_CONF_APP_STATS_WINDOW) {
+    TSL2591StatsSummary w = stats.flush();
+    printf("Window: %lu samples (%lu overflows)  Lux mean: %f  sd: %f  min: %f  max: %f  ewma: %f\n",
+           (unsigned long)w.count, (unsigned long)w.overflows, w.lux.mean, w.lux.stddev(),
+           w.lux.min, w.lux.max, w.luxEwma);
+    printf("        p50: %f  p90: %f  p99: %f  Full mean: %f  IR mean: %f\n",
+           w.luxP50, w.luxP90, w.luxP99, w.full.mean, w.ir.mean);
+  }
+#elif MBED_CONF_APP_FEATURES_WINDOW
+  features.add(s);
+  if (features.count() >= MBED_CONF_APP_FEATURES_WINDOW) {
+    TSL2591FeatureVector v = features.flush();
+    printf("Features: %u samples (%u saturated)  IR ratio: %lu  sd: %lu  hist: %u %u %u %u %u %u %u %u",
+           v.count, v.saturated, q16PerMille(v.ratioMean), q16PerMille(v.ratioStddev),
+           v.histogram[0] * 100 / 255, v.histogram[1] * 100 / 255, v.histogram[2] * 100 / 255,
+           v.histogram[3] * 100 / 255, v.histogram[4] * 100 / 255, v.histogram[5] * 100 / 255,
+           v.histogram[6] * 100 / 255, v.histogram[7] * 100 / 255);
+    if (v.flags & TSL2591_FEATURES_BANDS_VALID) {
+      printf("  bands: %lu %lu %lu %lu\n", q16PerMille(v.band[0]), q16PerMille(v.band[1]),
+             q16PerMille(v.band[2]), q16PerMille(v.band[3]));
+    } else {
+      printf("  bands: -\n");
+    }
+  }
+#elif MBED_CONF_APP_BINARY_STREAM
+  stream.send(s);
+#else
+#if MBED_CONF_APP_SAMPLE_BUFFER
+  // Printed later than taken, show when it was taken
+  printf("%lu ms  ", (unsigned long)s.timestamp);
+#endif
+#if MBED_CONF_APP_SERVICE_COMMANDS
+  if (s.flags & TSL2591_SAMPLE_RECONFIGURED) {
+    static const int gainFactors[4] = { 1, 25, 428, 9876 };
+    printf("New configuration, gain: %dx  timing: %d ms\n", gainFactors[(s.gain >> 4) & 0x03], 100 * (s.timing + 1));
+  }
+#endif
+  if (s.flags & TSL2591_SAMPLE_SATURATED) {
+    // Clipped, there is no lux value to this one
+    printf("IR: %d  Full: %d  saturated (%u retries)\n", s.ir, s.full, s.retries);
+    return;
+  }
+  printSample(s);
+#endif
+}
+
+#if MBED_CONF_APP_SAMPLE_BUFFER
+/**************************************************************************/
+/*
+    Consumer thread, drains the sample buffer at its own pace
+*/
+/**************************************************************************/
+void consumeSamples(void) {
+#if MBED_CONF_APP_BLOCK_FILTER
+  TSL2591Sample *run;
+  uint32_t n;
+  while (true) {
+    // Processed where they are, contiguous runs straight out of the buffer
+    while ((n = samples.readable(run)) > 0) {
+      n = block.load(run, n);
+      samples.consume(n);
+      block.convert(luxTable);
+      block.filter(lowpass);
+      printf("%lu..%lu ms  %u samples  Lux mean: %f  filtered: %f  (%lu overflows)\n",
+             (unsigned long)block.firstTimestamp(), (unsigned long)block.lastTimestamp(), (unsigned)block.count(),
+             tsl2591Mean(block.lux(), block.count()), block.filtered()[block.count() - 1],
+             (unsigned long)block.overflows());
+    }
+    ThisThread::sleep_for(1s);
+  }
+#else
+  TSL2591Sample s;
+  while (true) {
+    while (samples.pop(s)) {
+      outputSample(s);
+    }
+    ThisThread::sleep_for(100ms);
+  }
+#endif
+}
+#endif
+
+/**************************************************************************/
+/*
+    Passes a new sample on, with sample-buffer set it is queued for the
+    consumer thread instead of being sent right away
+*/
+/**************************************************************************/
+void queueSample(const TSL2591Sample &s) {
+#if MBED_CONF_APP_SAMPLE_LOG
+  logger.push(s);
+#endif
+#if MBED_CONF_APP_SAMPLE_BUFFER
+  samples.push(s);
+#else
+  outputSample(s);
+#endif
+}
+
+void handleSample(uint16_t ir, uint16_t full) {
+  // The shadow follows auto range, the settings cached in tsl don't
+  queueSample(TSL2591Sample::make(full, ir, regs.gain(), regs.timing()));
+}
+
+#if MBED_CONF_APP_SAMPLE_BUS
+/**************************************************************************/
+/*
+    Subscriber thread, passes every sample on like the plain service does
+*/
+/**************************************************************************/
+void outputSubscriber(void) {
+  while (true) {
+    const TSL2591Sample *s = bus.receive(outputId);
+    if (s) {
+      queueSample(*s);
+      bus.release(s);
+    }
+  }
+}
+#endif
+
+void printBusError(void) {
+  const TSL2591BusStats &bus = regs.busStats();
+  printf("I2C error (errors: %lu  retries: %lu  recoveries: %lu  failures: %lu)\n",
+         (unsigned long)bus.errors, (unsigned long)bus.retries, (unsigned long)bus.recoveries,
+         (unsigned long)bus.failures);
+}
+
 /**************************************************************************/
 /*
     Show how to read IR and Full Spectrum at once and convert to lux
@@ -81,13 +492,124 @@ void simpleRead(void) {
 void advancedRead(void) {
   // More advanced data read example. Read 32 bits with top 16 bits IR, bottom 16 bits full spectrum
   // That way you can do whatever math and comparisons you want!
-  uint32_t lum = tsl.getFullLuminosity();
+  // Both channels are fetched in one 4 byte transfer, so they are from the same conversion.
+#if MBED_CONF_APP_AUTO_RANGE
+  uint16_t ir, full;
+  bool valid;
+  if (autoRange.read(full, ir, valid)) {
+    printBusError();
+    return;
+  }
+  if (!valid) {
+    printf("Sample discarded (auto range), gain: %dx  timing: %d ms  total: %lu\n",
+           TSL2591AutoRange::gainFactor(regs.gain()), 100 * (regs.timing() + 1),
+           (unsigned long)autoRange.discarded());
+    return;
+  }
+  handleSample(ir, full);
+#elif MBED_CONF_APP_SATURATION_RETRIES
+  TSL2591Sample s;
+  if (saturation.read(s)) {
+    printBusError();
+    return;
+  }
+  queueSample(s);
+#else
+  uint32_t lum;
+  if (regs.readFullLuminosity(tsl.getTiming(), lum)) {
+    printBusError();
+    return;
+  }
   uint16_t ir, full;
   ir = lum >> 16;
   full = lum & 0xFFFF;
-  printf("IR: %d  Full: %d  Visible: %d  Lux: %f\n", ir, full, full-ir, tsl.calculateLux(full, ir));
+  handleSample(ir, full);
+#endif
+}
+
+#if MBED_CONF_APP_ASYNC_READ
+/**************************************************************************/
+/*
+    Same as advancedRead(), but the calling thread is not blocked for the
+    integration time. The result arrives in the event queue and the next
+    read is scheduled from there.
+*/
+/**************************************************************************/
+void asyncRead(void);
+
+void asyncReadDone(int status, uint32_t lum) {
+  if (status) {
+    printf("I2C error: %x\n", status);
+  } else {
+    uint16_t ir, full;
+    ir = lum >> 16;
+    full = lum & 0xFFFF;
+    handleSample(ir, full);
+  }
+  queue.call_in(500ms, asyncRead);
 }
 
+void asyncRead(void) {
+  asyncReader.start(asyncReadDone);
+}
+#endif
+
+#if MBED_CONF_APP_SCHEDULER
+/**************************************************************************/
+/*
+    A conversion of one of the scheduled sensors, runs in the event queue
+*/
+/**************************************************************************/
+void scheduledSample(size_t sensor, int status, uint32_t lum) {
+  if (status) {
+    printf("Sensor %u: I2C error: %d\n", (unsigned)sensor, status);
+    return;
+  }
+  handleSample(lum >> 16, lum & 0xFFFF);
+}
+#endif
+
+#if MBED_CONF_APP_SERVICE
+/**************************************************************************/
+/*
+    Prints the schedule statistics of the service, with service-commands
+    it is also retuned to the next gain
+*/
+/**************************************************************************/
+void reportService(void) {
+  TSL2591ServiceStats st = service.stats();
+  printf("Samples: %lu  errors: %lu  overruns: %lu  jitter avg: %lu ms  max: %lu ms\n",
+         (unsigned long)st.samples, (unsigned long)st.errors, (unsigned long)st.overruns,
+         (unsigned long)(st.samples ? st.jitterSumMs / st.samples : 0), (unsigned long)st.jitterMaxMs);
+#if MBED_CONF_APP_SERVICE_COMMANDS
+  // The acquisition goes on with the next gain
+  static const tsl2591Gain_t gains[4] = { TSL2591_GAIN_LOW, TSL2591_GAIN_MED, TSL2591_GAIN_HIGH, TSL2591_GAIN_MAX };
+  static unsigned step = 1;
+  service.setGain(gains[++step % 4]);
+  printf("Reconfigurations: %lu  errors: %lu\n", (unsigned long)st.reconfigs, (unsigned long)st.reconfigErrors);
+#endif
+}
+#endif
+
+/**************************************************************************/
+/*
+    Looks for the sensor until it answers, returns the I2C clock in use
+*/
+/**************************************************************************/
+int findSensor(void) {
+  while (true) {
+    int hz = regs.setFrequency(MBED_CONF_APP_I2C_FREQUENCY);
+#if MBED_CONF_APP_BUS_RECOVERY
+    if (hz && recovery.begin(hz)) {
+#else
+    if (hz && tsl.begin(i2c)) {
+#endif
+      return hz;
+    }
+    printf("No sensor found ... check your wiring?\n");
+    ThisThread::sleep_for(1s);
+  }
+}
 
 /**************************************************************************/
 /*
@@ -98,10 +620,13 @@ int main() {
 
   printf("Starting Adafruit TSL2591 Test!\n");
 
-  if(!tsl.begin(i2c)) {
-    printf("No sensor found ... check your wiring?\n");
-    while (1);
-  }
+#if TSL2591_TRACE
+  tsl2591TraceInit();
+#endif
+
+  regs.setRetries(MBED_CONF_APP_I2C_RETRIES, std::chrono::milliseconds(TSL2591_I2C_RETRY_DELAY_MS));
+  int hz = findSensor();
+  printf("I2C clock: %d Hz\n", hz);
 
   uint8_t id = tsl.getID();
   printf("------------------------------------\n");
@@ -111,10 +636,138 @@ int main() {
   /* Configure the sensor */
   configureSensor();
 
+#if MBED_CONF_APP_DATA_READY && MBED_CONF_APP_DATA_READY_INT && !MBED_CONF_APP_CONTINUOUS
+  dataReady.attach();
+#elif MBED_CONF_APP_DATA_READY
+  // Reads start when AVALID is set, not after the worst case integration time
+  regs.attachWait(callback(&regs, &TSL2591Registers::waitValid));
+#endif
+
+#if MBED_CONF_APP_BUS_RECOVERY
+  recovery.configured(hz);
+  recovery.attach();
+#endif
+
+#if MBED_CONF_APP_SAMPLE_LOG
+  int err = logger.init();
+  if (err) {
+    printf("Sample log not available: %d\n", err);
+  } else {
+    printf("Sample log: block %lu of %lu, sequence %lu\n", (unsigned long)logger.position(),
+           (unsigned long)logger.blocks(), (unsigned long)logger.sequence());
+  }
+#endif
+
+#if MBED_CONF_APP_SAMPLE_BUFFER
+  consumer.start(consumeSamples);
+#endif
+
+#if MBED_CONF_APP_FOOTPRINT_REPORT
+  // Everything is set up, nothing should be on the heap
+  tsl2591FootprintReport();
+#endif
+
+#if MBED_CONF_APP_SERVICE
+#if MBED_CONF_APP_SAMPLE_BUS
+  // Main is the second subscriber, it gets every n-th sample
+  outputId = bus.subscribe();
+  decimatedId = bus.subscribe(MBED_CONF_APP_SAMPLE_BUS_DECIMATION);
+  subscriber.start(outputSubscriber);
+  service.start(bus);
+  Kernel::Clock::time_point report = Kernel::Clock::now() + 10s;
+  while (true) {
+    const TSL2591Sample *s = bus.receive(decimatedId, 1s);
+    if (s) {
+#if MBED_CONF_APP_FIXED_POINT_LUX
+      char lux[16];
+      tsl2591FormatMilliLux(lux, sizeof(lux), sampleMilliLux(*s));
+      printf("Every %d: %lu ms  Lux: %s\n", MBED_CONF_APP_SAMPLE_BUS_DECIMATION, (unsigned long)s->timestamp, lux);
+#else
+      printf("Every %d: %lu ms  Lux: %f\n", MBED_CONF_APP_SAMPLE_BUS_DECIMATION, (unsigned long)s->timestamp,
+             sampleLux(*s));
+#endif
+      bus.release(s);
+    }
+    if (Kernel::Clock::now() >= report) {
+      report += 10s;
+      TSL2591SubscriberStats out = bus.stats(outputId);
+      printf("Bus: delivered: %lu  dropped: %lu  pool exhausted: %lu\n", (unsigned long)out.delivered,
+             (unsigned long)out.dropped, (unsigned long)bus.poolExhausted());
+      reportService();
+    }
+  }
+#else
+  // The service thread samples, main only reports the schedule statistics
+  service.start(queueSample);
+  while (true) {
+    ThisThread::sleep_for(10s);
+    reportService();
+  }
+#endif
+#elif MBED_CONF_APP_CONTINUOUS
+  // Frames of back to back samples, the sensor keeps integrating meanwhile
+  int status;
+  while ((status = continuous.start()) != 0) {
+    // Nothing to acquire() until the thread runs, try again
+    printf("Continuous mode failed to start: %d\n", status);
+    ThisThread::sleep_for(1s);
+  }
+  while (true) {
+    size_t n;
+    const TSL2591Sample *frame = continuous.acquire(n);
+    for (size_t i = 0; i < n; i++) {
+      queueSample(frame[i]);
+    }
+    continuous.release();
+    TSL2591ContinuousStats st = continuous.stats();
+    printf("Frames: %lu  samples: %lu  overruns: %lu  missed: %lu  errors: %lu\n",
+           (unsigned long)st.frames, (unsigned long)st.samples, (unsigned long)st.overruns,
+           (unsigned long)st.missed, (unsigned long)st.errors);
+  }
+#elif MBED_CONF_APP_ASYNC_READ
+  // Reads run from the event queue, the main thread is free in between
+  asyncRead();
+  queue.dispatch_forever();
+#elif MBED_CONF_APP_SCHEDULER
+  // Every conversion is read, the ALS keeps integrating
+  scheduler.addSensor(tsl, i2c);
+  while (!scheduler.start(tsl.getTiming())) {
+    printf("Scheduler failed to start\n");
+    ThisThread::sleep_for(1s);
+  }
+  queue.dispatch_forever();
+#elif MBED_CONF_APP_DUTY_CYCLE
+  for (uint32_t n = 1; ; n++) {
+    uint32_t lum;
+    if (dutyCycle.sample(lum) == 0) {
+      handleSample(lum >> 16, lum & 0xFFFF);
+    }
+    if (n % 20 == 0) {
+      TSL2591EnergyReport r = dutyCycle.report();
+      printf("Energy: %lu uJ/sample  sensor on: %lu ms  run: %lu ms  sleep: %lu ms  deep sleep: %lu ms%s\n",
+             (unsigned long)r.energyPerSampleUj, (unsigned long)(r.sensorActiveUs / 1000),
+             (unsigned long)(r.runUs / 1000), (unsigned long)(r.sleepUs / 1000),
+             (unsigned long)(r.deepSleepUs / 1000), r.deepSleepLocked ? "  (deep sleep locked!)" : "");
+    }
+  }
+#else
   // Now we're ready to get readings ... move on to loop()!
-  while(true) { 
+  for (uint32_t n = 1; ; n++) {
     //simpleRead(); 
     advancedRead();
+#if TSL2591_TRACE
+    // Bus transfers and ADC waits of the last reads
+    if (n % 10 == 0) {
+      tsl2591TraceDump();
+    }
+#endif
+#if MBED_CONF_APP_FOOTPRINT_REPORT
+    // Again every 30 s, with the stack high water marks of the reads
+    if (n % 60 == 0) {
+      tsl2591FootprintReport();
+    }
+#endif
     thread_sleep_for(500);
   }
+#endif
 }
@@ -0,0 +1,241 @@
+/* TSL2591 Digital Light Sensor, timing benchmark */
+
+/*  Measures where the time of a sample goes:
+ *
+ *    - begin()
+ *    - single register read and write, 4 byte burst read of both channels
+ *    - getFullLuminosity() wall time for every integration time
+ *    - calculateLux()
+ *    - formatting the "IR: ... Lux: ..." line of the examples
+ *
+ *  The I2C measurements are repeated for every bus clock in
+ *  frequencies[]. Results are printed as min/avg/p99/max, in CPU cycles
+ *  (DWT cycle counter, Cortex-M3 and up) or in us (Timer) on cores
+ *  without DWT. Keep the output of a run as baseline to compare changes.
+ */
+
+#include "mbed.h"
+#include "Adafruit_TSL2591.h"
+#include <algorithm>
+
+// connect SCL to I2C Clock
+// connect SDA to I2C Data
+// connect Vin to 3.3-5V DC
+// connect GROUND to common ground
+I2C i2c(I2C_SDA , I2C_SCL );
+
+Adafruit_TSL2591 tsl = Adafruit_TSL2591(2591); // pass in a number for the sensor identifier (for your use later)
+
+#define BENCH_REPETITIONS             (MBED_CONF_APP_REPETITIONS)
+#define BENCH_INTEGRATION_REPETITIONS (MBED_CONF_APP_INTEGRATION_REPETITIONS)
+#define BENCH_BEGIN_REPETITIONS       (10)
+
+static const int frequencies[] = { 100000, 400000 };
+
+static uint32_t ticks[BENCH_REPETITIONS];
+
+/**************************************************************************/
+/*
+    Time base: cycles where the core has a DWT, us otherwise
+*/
+/**************************************************************************/
+#if defined(DWT) && (__CORTEX_M >= 3)
+#define COUNTER_UNIT "cycles"
+
+static void counterInit(void) {
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+#if (__CORTEX_M == 7)
+  // The DWT of the M7 ignores writes until it is unlocked
+  DWT->LAR = 0xC5ACCE55;
+#endif
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+static inline uint32_t counterRead(void) {
+  return DWT->CYCCNT;
+}
+
+static uint32_t counterToUs(uint32_t t) {
+  return t / (SystemCoreClock / 1000000);
+}
+#else
+#define COUNTER_UNIT "us"
+
+static Timer counterTimer;
+
+static void counterInit(void) {
+  counterTimer.start();
+}
+
+static inline uint32_t counterRead(void) {
+  return (uint32_t)counterTimer.elapsed_time().count();
+}
+
+static uint32_t counterToUs(uint32_t t) {
+  return t;
+}
+#endif
+
+/**************************************************************************/
+/*
+    Prints min/avg/p99/max of n measurements (sorts t), in counter units
+    or with us set of values already in us. The p99 is interpolated
+    between the two closest ranks, so it is below the max unless the
+    slowest runs are equal.
+*/
+/**************************************************************************/
+static void report(const char *name, uint32_t *t, size_t n, bool us = false) {
+  std::sort(t, t + n);
+  uint64_t sum = 0;
+  for (size_t i = 0; i < n; i++) {
+    sum += t[i];
+  }
+  uint32_t avg = sum / n;
+  size_t rank = (n - 1) * 99 / 100;
+  uint32_t p99 = t[rank];
+  if (rank + 1 < n) {
+    p99 += (uint32_t)((uint64_t)(t[rank + 1] - t[rank]) * ((n - 1) * 99 % 100) / 100);
+  }
+  printf("%-28s min %8lu  avg %8lu  p99 %8lu  max %8lu %s", name, (unsigned long)t[0],
+         (unsigned long)avg, (unsigned long)p99, (unsigned long)t[n - 1], us ? "us" : COUNTER_UNIT);
+  if (!us) {
+    printf("  (avg %lu us)", (unsigned long)counterToUs(avg));
+  }
+  printf("\n");
+}
+
+static int readRegister(uint8_t reg, char *data, int len) {
+  char cmd = TSL2591_COMMAND_BIT | reg;
+  int err = i2c.write(TSL2591_ADDR << 1, &cmd, 1, true);
+  if (err == 0) {
+    err = i2c.read(TSL2591_ADDR << 1, data, len);
+  }
+  return err;
+}
+
+static int writeRegister(uint8_t reg, uint8_t value) {
+  char cmd[2] = { (char)(TSL2591_COMMAND_BIT | reg), (char)value };
+  return i2c.write(TSL2591_ADDR << 1, cmd, sizeof(cmd));
+}
+
+/**************************************************************************/
+/*
+    Bus benchmarks for the current I2C clock
+*/
+/**************************************************************************/
+static void benchBus(void) {
+  uint32_t t0;
+  int errors = 0;
+  char data[4];
+
+  for (int i = 0; i < BENCH_BEGIN_REPETITIONS; i++) {
+    t0 = counterRead();
+    errors += tsl.begin(i2c) ? 0 : 1;
+    ticks[i] = counterRead() - t0;
+  }
+  report("begin()", ticks, BENCH_BEGIN_REPETITIONS);
+
+  for (int i = 0; i < BENCH_REPETITIONS; i++) {
+    t0 = counterRead();
+    errors += readRegister(TSL2591_REGISTER_DEVICE_ID, data, 1) ? 1 : 0;
+    ticks[i] = counterRead() - t0;
+  }
+  report("register read (1 byte)", ticks, BENCH_REPETITIONS);
+
+  // Writes the current CONTROL value back, the configuration is unchanged
+  readRegister(TSL2591_REGISTER_CONTROL, data, 1);
+  for (int i = 0; i < BENCH_REPETITIONS; i++) {
+    t0 = counterRead();
+    errors += writeRegister(TSL2591_REGISTER_CONTROL, data[0]) ? 1 : 0;
+    ticks[i] = counterRead() - t0;
+  }
+  report("register write (1 byte)", ticks, BENCH_REPETITIONS);
+
+  for (int i = 0; i < BENCH_REPETITIONS; i++) {
+    t0 = counterRead();
+    errors += readRegister(TSL2591_REGISTER_CHAN0_LOW, data, 4) ? 1 : 0;
+    ticks[i] = counterRead() - t0;
+  }
+  report("burst read CH0+CH1 (4 byte)", ticks, BENCH_REPETITIONS);
+
+  // Wall time is dominated by the integration, measure it in us (the
+  // cycle counter stops while the core sleeps waiting for the conversion)
+  Timer timer;
+  timer.start();
+  for (int t = TSL2591_INTEGRATIONTIME_100MS; t <= TSL2591_INTEGRATIONTIME_600MS; t++) {
+    char name[32];
+    tsl.setTiming((tsl2591IntegrationTime_t)t);
+    for (int i = 0; i < BENCH_INTEGRATION_REPETITIONS; i++) {
+      timer.reset();
+      tsl.getFullLuminosity();
+      ticks[i] = (uint32_t)timer.elapsed_time().count();
+    }
+    snprintf(name, sizeof(name), "getFullLuminosity() %d ms", 100 * (t + 1));
+    report(name, ticks, BENCH_INTEGRATION_REPETITIONS, true);
+  }
+
+  if (errors) {
+    printf("%d I2C errors!\n", errors);
+  }
+}
+
+/**************************************************************************/
+/*
+    CPU benchmarks, independent of the bus
+*/
+/**************************************************************************/
+static void benchCpu(void) {
+  volatile float sink = 0;
+  uint32_t t0;
+  char line[64];
+
+  for (int i = 0; i < BENCH_REPETITIONS; i++) {
+    uint16_t full = 1000 + 173 * i;
+    uint16_t ir = full / 4;
+    t0 = counterRead();
+    sink = tsl.calculateLux(full, ir);
+    ticks[i] = counterRead() - t0;
+  }
+  report("calculateLux()", ticks, BENCH_REPETITIONS);
+
+  for (int i = 0; i < BENCH_REPETITIONS; i++) {
+    uint16_t full = 1000 + 173 * i;
+    uint16_t ir = full / 4;
+    t0 = counterRead();
+    snprintf(line, sizeof(line), "IR: %d  Full: %d  Visible: %d  Lux: %f\n", ir, full, full-ir, sink);
+    ticks[i] = counterRead() - t0;
+  }
+  report("format sample line", ticks, BENCH_REPETITIONS);
+}
+
+/**************************************************************************/
+/*
+    Program entry point
+*/
+/**************************************************************************/
+int main() {
+
+  printf("Starting Adafruit TSL2591 benchmark!\n");
+
+  counterInit();
+
+  if(!tsl.begin(i2c)) {
+    printf("No sensor found ... check your wiring?\n");
+    while (1);
+  }
+  tsl.setGain(TSL2591_GAIN_MED);
+
+  printf("------------------------------------\n");
+  printf("Core clock: %lu Hz\n", (unsigned long)SystemCoreClock);
+  benchCpu();
+
+  for (size_t f = 0; f < sizeof(frequencies) / sizeof(frequencies[0]); f++) {
+    printf("------------------------------------\n");
+    printf("I2C clock: %d Hz\n", frequencies[f]);
+    i2c.frequency(frequencies[f]);
+    benchBus();
+  }
+  printf("------------------------------------\n");
+  printf("Done.\n");
+}
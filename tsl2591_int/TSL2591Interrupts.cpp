@@ -0,0 +1,155 @@
+/* TSL2591 Digital Light Sensor, separate alarm and trend interrupts */
+
+#include "TSL2591Interrupts.h"
+
+TSL2591Interrupts::TSL2591Interrupts(I2C &i2c, InterruptIn &intPin)
+  : _i2c(i2c), _int(intPin), _alarmQueue(NULL), _trendQueue(NULL),
+    _alarmHeld(false) {
+}
+
+int TSL2591Interrupts::setAlarmWindow(uint16_t lower, uint16_t upper) {
+  char data[4] = { (char)(lower & 0xFF), (char)(lower >> 8), (char)(upper & 0xFF), (char)(upper >> 8) };
+  return write(TSL2591_REGISTER_THRESHOLD_NPAILTL, data, sizeof(data));
+}
+
+int TSL2591Interrupts::setTrendWindow(uint16_t lower, uint16_t upper, tsl2591Persist_t persist) {
+  char data[4] = { (char)(lower & 0xFF), (char)(lower >> 8), (char)(upper & 0xFF), (char)(upper >> 8) };
+  int err = write(TSL2591_REGISTER_THRESHOLD_AILTL, data, sizeof(data));
+  if (err == 0) {
+    char p = (char)persist;
+    err = write(TSL2591_REGISTER_PERSIST_FILTER, &p, 1);
+  }
+  return err;
+}
+
+void TSL2591Interrupts::onAlarm(EventQueue &queue, event_callback_t cb) {
+  _alarmQueue = &queue;
+  _onAlarm = cb;
+}
+
+void TSL2591Interrupts::onTrend(EventQueue &queue, event_callback_t cb) {
+  _trendQueue = &queue;
+  _onTrend = cb;
+}
+
+int TSL2591Interrupts::start(void) {
+  if (!_alarmQueue) {
+    return -1;
+  }
+  _int.fall(_alarmQueue->event(this, &TSL2591Interrupts::service));
+  _alarmHeld = false;
+
+  char clear = TSL2591_CLEAR_INT;
+  int err = _i2c.write(TSL2591_ADDR << 1, &clear, 1);
+  if (err == 0) {
+    char enable = TSL2591_ENABLE_POWERON | TSL2591_ENABLE_AEN |
+                  TSL2591_ENABLE_AIEN | TSL2591_ENABLE_NPIEN;
+    err = write(TSL2591_REGISTER_ENABLE, &enable, 1);
+  }
+  return err;
+}
+
+/**************************************************************************/
+/*
+    Runs in the alarm queue: STATUS and C0DATAL..C1DATAH are consecutive
+    registers, so one read returns the cause and the matching channels.
+    I2C releases its mutex after each call, the lock keeps the main
+    thread (setTrendWindow()) off the bus between the repeated start
+    and the read.
+
+    INT stays low until the interrupts are cleared, there won't be
+    another edge: a failed read or clear is retried. The callbacks only
+    run once the clear went through, the retry would report the same
+    event again otherwise.
+*/
+/**************************************************************************/
+void TSL2591Interrupts::service(void) {
+  char cmd = TSL2591_COMMAND_BIT | TSL2591_REGISTER_DEVICE_STATUS;
+  char data[5];
+  _i2c.lock();
+  int err = _i2c.write(TSL2591_ADDR << 1, &cmd, 1, true);
+  if (err) {
+    _i2c.stop();
+  } else {
+    err = _i2c.read(TSL2591_ADDR << 1, data, sizeof(data));
+  }
+  _i2c.unlock();
+  if (err == 0) {
+    char clear = TSL2591_CLEAR_INT;
+    err = _i2c.write(TSL2591_ADDR << 1, &clear, 1);
+  }
+  if (err) {
+    _alarmQueue->call_in(100ms, callback(this, &TSL2591Interrupts::service));
+    return;
+  }
+
+  uint8_t status = data[0];
+  uint16_t full = (uint8_t)data[1] | ((uint8_t)data[2] << 8);
+  uint16_t ir   = (uint8_t)data[3] | ((uint8_t)data[4] << 8);
+  uint32_t lum = ((uint32_t)ir << 16) | full;
+
+  // STATUS has NPINTR set during the hold-off too, NPIEN only gates INT
+  bool alarm = (status & TSL2591_STATUS_NPINTR) && !_alarmHeld;
+  bool trend = (status & TSL2591_STATUS_AINT) != 0;
+  if (alarm && _onAlarm) {
+    _onAlarm(status, lum);
+  }
+  if (trend && _onTrend) {
+    if (_trendQueue && _trendQueue != _alarmQueue) {
+      _trendQueue->call(_onTrend, status, lum);
+    } else {
+      _onTrend(status, lum);
+    }
+  }
+
+  if (alarm && TSL2591_ALARM_HOLDOFF_MS > 0) {
+    _alarmHeld = true;
+    _alarmQueue->call_in(std::chrono::milliseconds(TSL2591_ALARM_HOLDOFF_MS),
+                         callback(this, &TSL2591Interrupts::releaseAlarm));
+  }
+  if (trend) {
+    // AEN off restarts the persist filter, like restartSensor() of the example
+    char enable = TSL2591_ENABLE_POWERON;
+    write(TSL2591_REGISTER_ENABLE, &enable, 1);
+  }
+  if (alarm || trend) {
+    arm();
+  }
+}
+
+/**************************************************************************/
+/*
+    End of the alarm hold-off, runs in the alarm queue
+*/
+/**************************************************************************/
+void TSL2591Interrupts::releaseAlarm(void) {
+  _alarmHeld = false;
+  arm();
+}
+
+/**************************************************************************/
+/*
+    Enables the ALS and the interrupts, NPIEN only outside the alarm
+    hold-off. Retried until it went through, the sensor would stay off
+    after a failed restart.
+*/
+/**************************************************************************/
+void TSL2591Interrupts::arm(void) {
+  char enable = TSL2591_ENABLE_POWERON | TSL2591_ENABLE_AEN | TSL2591_ENABLE_AIEN;
+  if (!_alarmHeld) {
+    enable |= TSL2591_ENABLE_NPIEN;
+  }
+  if (write(TSL2591_REGISTER_ENABLE, &enable, 1)) {
+    _alarmQueue->call_in(100ms, callback(this, &TSL2591Interrupts::arm));
+  }
+}
+
+int TSL2591Interrupts::write(uint8_t reg, const char *data, int len) {
+  char cmd[5];
+  if (len > 4) {
+    return -1;
+  }
+  cmd[0] = (char)(TSL2591_COMMAND_BIT | reg);
+  memcpy(&cmd[1], data, len);
+  return _i2c.write(TSL2591_ADDR << 1, cmd, len + 1);
+}
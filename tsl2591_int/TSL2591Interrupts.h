@@ -0,0 +1,78 @@
+/* TSL2591 Digital Light Sensor, separate alarm and trend interrupts */
+
+#ifndef TSL2591_INTERRUPTS_H
+#define TSL2591_INTERRUPTS_H
+
+#include "mbed.h"
+#include "Adafruit_TSL2591.h"
+
+// Bits of the STATUS register, Adafruit_TSL2591.h has none (same names as
+// TSL2591Registers.h of the tsl2591 example)
+#define TSL2591_STATUS_AVALID (0x01)
+#define TSL2591_STATUS_AINT   (0x10)
+#define TSL2591_STATUS_NPINTR (0x20)
+
+// The alarm is off for this long after it fired, 0 reports every conversion
+#ifndef TSL2591_ALARM_HOLDOFF_MS
+#define TSL2591_ALARM_HOLDOFF_MS (1000)
+#endif
+
+/**************************************************************************/
+/*
+    Uses both interrupt channels of the TSL2591 for different jobs:
+
+      alarm  no-persist window, fires on the first conversion outside it
+             (flash, shadow), usually wide
+      trend  persisted window (TSL2591_PERSIST_*), fires once the level
+             stayed outside for a number of conversions, usually narrow
+
+    Both share the INT pin. The pin interrupt is deferred to the alarm
+    queue, which reads STATUS and both channels in one 5 byte burst,
+    clears the interrupts and calls the alarm callback right there. A
+    trend event is forwarded to the trend queue. Dispatch the alarm queue
+    from a higher priority thread than the trend queue, so alarms don't
+    wait behind trend processing (or anything else).
+
+    Neither source repeats: after a trend event the ALS is restarted (AEN
+    off/on), so the persist filter counts from zero again, and after an
+    alarm the no-persist interrupt stays disabled for
+    TSL2591_ALARM_HOLDOFF_MS. A level that stays outside a window is
+    reported once per persist period and once per hold-off respectively.
+
+    The ALS stays enabled, don't use getFullLuminosity() or
+    registerInterrupt() of Adafruit_TSL2591 (both disable it), the
+    channels are handed to the callbacks.
+*/
+/**************************************************************************/
+class TSL2591Interrupts {
+public:
+  typedef Callback<void(uint8_t status, uint32_t lum)> event_callback_t;
+
+  TSL2591Interrupts(I2C &i2c, InterruptIn &intPin);
+
+  int setAlarmWindow(uint16_t lower, uint16_t upper);
+  int setTrendWindow(uint16_t lower, uint16_t upper, tsl2591Persist_t persist);
+
+  /* Queues and callbacks, call before start() */
+  void onAlarm(EventQueue &queue, event_callback_t cb);
+  void onTrend(EventQueue &queue, event_callback_t cb);
+
+  /* Clears pending interrupts and enables the ALS with both interrupts */
+  int start(void);
+
+private:
+  void service(void);
+  void releaseAlarm(void);
+  void arm(void);
+  int write(uint8_t reg, const char *data, int len);
+
+  I2C &_i2c;
+  InterruptIn &_int;
+  EventQueue *_alarmQueue;
+  EventQueue *_trendQueue;
+  event_callback_t _onAlarm;
+  event_callback_t _onTrend;
+  bool _alarmHeld;
+};
+
+#endif
@@ -34,10 +34,28 @@
  *  values):
  *  
  *    tsl.registerInterrupt(100, 1500, TSL2591_PERSIST_5);
+ *
+ *  With report-on-change set in mbed_app.json the window is not fixed:
+ *  after every reading it is moved around the current CH0 value, so an
+ *  interrupt (and a line of output) only comes when the light level
+ *  changed by more than the configured hysteresis.
+ *
+ *  With dual-rate set both interrupt channels are used: a wide no-persist
+ *  window for instant alarms, handled in a high priority thread, and the
+ *  persisted window above for trend events (see TSL2591Interrupts.h).
+ *
+ *  This example uses the HW pin: the open drain, active low INT output
+ *  is wired to MBED_CONF_APP_TSL2591_INT_PIN (see mbed_app.json). The
+ *  falling edge defers the work to an EventQueue, so the main thread only
+ *  wakes up (and touches the I2C bus) when the sensor asks for it and is
+ *  free to enter deep sleep in between.
  */
 
 #include "mbed.h"
 #include "Adafruit_TSL2591.h"
+#if MBED_CONF_APP_DUAL_RATE
+#include "TSL2591Interrupts.h"
+#endif
 
 // Example for demonstrating the TSL2591 library - public domain!
 
@@ -47,14 +65,66 @@
 // connect GROUND to common ground
 I2C i2c(I2C_SDA , I2C_SCL );
 
+// connect INT to the pin configured in mbed_app.json (open drain, needs the pull-up)
+InterruptIn tslInt(MBED_CONF_APP_TSL2591_INT_PIN, PullUp);
+
+// With a static event buffer, EventQueue would otherwise allocate it
+unsigned char queueBuffer[8 * EVENTS_EVENT_SIZE];
+EventQueue queue(sizeof(queueBuffer), queueBuffer);
+
 // Interrupt thresholds and persistance
 #define TLS2591_INT_THRESHOLD_LOWER  (100)
 #define TLS2591_INT_THRESHOLD_UPPER  (1500)
 //#define TLS2591_INT_PERSIST        (TSL2591_PERSIST_ANY) // Fire on any valid change
-#define TLS2591_INT_PERSIST          (TSL2591_PERSIST_60)  // Require at least 60 samples to fire
+#define TLS2591_INT_PERSIST          (MBED_CONF_APP_INT_PERSIST)  // TSL2591_PERSIST_60 requires at least 60 samples to fire
+
+// Report on change: window around the last CH0 reading, see mbed_app.json
+#define TLS2591_CHANGE_PERCENT       (MBED_CONF_APP_CHANGE_HYSTERESIS_PERCENT)
+#define TLS2591_CHANGE_COUNTS        (MBED_CONF_APP_CHANGE_HYSTERESIS_COUNTS)
 
 Adafruit_TSL2591 tsl = Adafruit_TSL2591(2591); // pass in a number for the sensor identifier (for your use later)
 
+#if MBED_CONF_APP_DUAL_RATE
+// Alarms are handled in their own, higher priority thread (printf with floats needs the stack)
+unsigned char alarmQueueBuffer[8 * EVENTS_EVENT_SIZE];
+EventQueue alarmQueue(sizeof(alarmQueueBuffer), alarmQueueBuffer);
+MBED_ALIGN(8) unsigned char alarmStack[2048];
+Thread alarmThread(osPriorityHigh, sizeof(alarmStack), alarmStack, "tsl2591 alarm");
+
+TSL2591Interrupts interrupts(i2c, tslInt);
+#endif
+
+/**************************************************************************/
+/*
+    Register level access for the interrupt path. Unlike the Adafruit
+    calls these don't go through enable()/disable(), which would switch
+    the no-persist interrupt on and the ALS off again. A read keeps the
+    bus from the address write to the data (repeated start).
+*/
+/**************************************************************************/
+int writeRegisters(uint8_t reg, const char *data, int len) {
+  char cmd[5];
+  if (len > 4) {
+    return -1;
+  }
+  cmd[0] = (char)(TSL2591_COMMAND_BIT | reg);
+  memcpy(&cmd[1], data, len);
+  return i2c.write(TSL2591_ADDR << 1, cmd, len + 1);
+}
+
+int readRegisters(uint8_t reg, char *data, int len) {
+  char cmd = (char)(TSL2591_COMMAND_BIT | reg);
+  i2c.lock();
+  int err = i2c.write(TSL2591_ADDR << 1, &cmd, 1, true);
+  if (err) {
+    i2c.stop();
+  } else {
+    err = i2c.read(TSL2591_ADDR << 1, data, len);
+  }
+  i2c.unlock();
+  return err;
+}
+
 /**************************************************************************/
 /*
     Configures the gain and integration time for the TSL2591
@@ -95,6 +165,11 @@ void configureSensor(void) {
   }
   printf("------------------------------------\n");
 
+  /* The Adafruit calls below switch the no-persist interrupt on for a moment, */
+  /* a window CH0 can't leave keeps it from firing (the reset default is 0/0) */
+  char npWindow[4] = { 0x00, 0x00, (char)0xFF, (char)0xFF };
+  writeRegisters(TSL2591_REGISTER_THRESHOLD_NPAILTL, npWindow, sizeof(npWindow));
+
   /* Setup the SW interrupt to trigger between 100 and 1500 lux */
   /* Threshold values are defined at the top of this sketch */
   tsl.clearInterrupt();
@@ -108,22 +183,105 @@ void configureSensor(void) {
 
 /**************************************************************************/
 /*
-    Show how to read IR and Full Spectrum at once and convert to lux
+    Powers the sensor up with the ALS and the (persisted) ALS interrupt
+    enabled, from then on it converts continuously. registerInterrupt()
+    and getFullLuminosity() leave the sensor disabled, nothing after
+    configureSensor() uses them. The no-persist interrupt is left off, it
+    is not used here.
 */
 /**************************************************************************/
-void advancedRead(void) {
-  // More advanced data read example. Read 32 bits with top 16 bits IR, bottom 16 bits full spectrum
-  // That way you can do whatever math and comparisons you want!
-  uint32_t lum = tsl.getFullLuminosity();
+void armSensor(void) {
+  char cmd[2] = { (char)(TSL2591_COMMAND_BIT | TSL2591_REGISTER_ENABLE),
+                  (char)(TSL2591_ENABLE_POWERON | TSL2591_ENABLE_AEN | TSL2591_ENABLE_AIEN) };
+  i2c.write(TSL2591_ADDR << 1, cmd, sizeof(cmd));
+}
+
+/**************************************************************************/
+/*
+    While CH0 stays outside the window the persistence filter stays
+    satisfied and every further conversion raises INT. Switching AEN off
+    and on again starts the count over, the next event comes after
+    another TLS2591_INT_PERSIST conversions outside.
+*/
+/**************************************************************************/
+void restartSensor(void) {
+  char cmd[2] = { (char)(TSL2591_COMMAND_BIT | TSL2591_REGISTER_ENABLE), (char)TSL2591_ENABLE_POWERON };
+  i2c.write(TSL2591_ADDR << 1, cmd, sizeof(cmd));
+  armSensor();
+}
+
+/**************************************************************************/
+/*
+    Moves the threshold window to the current light level: the next
+    interrupt only fires once CH0 left it by the configured hysteresis
+    (fixed counts if set, otherwise percent of the reading). The change
+    detection runs in the sensor, the MCU sleeps until it is meaningful.
+    Written at register level, registerInterrupt() would cycle ENABLE
+    (and the INT pin) on every call.
+*/
+/**************************************************************************/
+void armChangeWindow(uint16_t full) {
+  uint32_t band = TLS2591_CHANGE_COUNTS ? TLS2591_CHANGE_COUNTS
+                                        : (uint32_t)full * TLS2591_CHANGE_PERCENT / 100;
+  if (band == 0) {
+    band = 1;
+  }
+  uint16_t lower = (full > band) ? full - band : 0;
+  uint16_t upper = ((uint32_t)full + band < 0xFFFF) ? full + band : 0xFFFF;
+
+#if MBED_CONF_APP_DUAL_RATE
+  // Only the persisted (trend) window moves, the ALS keeps running
+  interrupts.setTrendWindow(lower, upper, TLS2591_INT_PERSIST);
+#else
+  char window[4] = { (char)(lower & 0xFF), (char)(lower >> 8), (char)(upper & 0xFF), (char)(upper >> 8) };
+  char persist = (char)TLS2591_INT_PERSIST;
+  if (writeRegisters(TSL2591_REGISTER_THRESHOLD_AILTL, window, sizeof(window)) ||
+      writeRegisters(TSL2591_REGISTER_PERSIST_FILTER, &persist, 1)) {
+    printf("I2C error, threshold window not moved\n");
+    return;
+  }
+#endif
+  printf("Interrupt Threshold Window: %d to %d\n", lower, upper);
+}
+
+void printLuminosity(uint32_t lum) {
   uint16_t ir, full;
   ir = lum >> 16;
   full = lum & 0xFFFF;
   printf("IR: %d  Full: %d  Visible: %d  Lux: %f\n", ir, full, full-ir, tsl.calculateLux(full, ir));
 }
 
+/**************************************************************************/
+/*
+    Show how to read IR and Full Spectrum at once and convert to lux. The
+    ALS keeps running (armSensor()), so this is the last conversion, in
+    the handler the one that raised INT. A bus error is reported instead
+    of a reading.
+*/
+/**************************************************************************/
+int advancedRead(uint16_t &full) {
+  // More advanced data read example. Read 32 bits with top 16 bits IR, bottom 16 bits full spectrum
+  // That way you can do whatever math and comparisons you want!
+  char data[4];
+  int err = readRegisters(TSL2591_REGISTER_CHAN0_LOW, data, sizeof(data));
+  if (err) {
+    printf("I2C error %d reading the channels\n", err);
+    return err;
+  }
+  full = (uint8_t)data[0] | ((uint8_t)data[1] << 8);
+  uint16_t ir = (uint8_t)data[2] | ((uint8_t)data[3] << 8);
+  printLuminosity(((uint32_t)ir << 16) | full);
+  return 0;
+}
 
-void getStatus(void) {
-  uint8_t x = tsl.getStatus();
+
+int getStatus(void) {
+  char x;
+  int err = readRegisters(TSL2591_REGISTER_DEVICE_STATUS, &x, 1);
+  if (err) {
+    printf("I2C error %d reading the status\n", err);
+    return err;
+  }
   // bit 4: ALS Interrupt occured
   // bit 5: No-persist Interrupt occurence
   if (x & 0x10) {
@@ -133,10 +291,66 @@ void getStatus(void) {
     printf("No-persist Interrupt occured\n");
   }
 
-  printf("Status: %x\n", x);
-  tsl.clearInterrupt();
+  printf("Status: %x\n", (uint8_t)x);
+  return 0;
+}
+
+int clearInterrupt(void) {
+  char clear = TSL2591_CLEAR_INT;
+  return i2c.write(TSL2591_ADDR << 1, &clear, 1);
 }
 
+/**************************************************************************/
+/*
+    Runs in the context of the event queue after the INT pin went low
+*/
+/**************************************************************************/
+void onSensorInterrupt(void) {
+  uint16_t full;
+  if (getStatus() == 0 && advancedRead(full) == 0) {
+#if MBED_CONF_APP_REPORT_ON_CHANGE
+    armChangeWindow(full);
+#endif
+    // Cleared last, a conversion before the window moved would fire again
+    if (clearInterrupt() == 0) {
+#if !MBED_CONF_APP_REPORT_ON_CHANGE
+      // The fixed window doesn't move
+      restartSensor();
+#endif
+      return;
+    }
+  }
+  // INT stays low until it is cleared, there won't be another edge
+  queue.call_in(100ms, onSensorInterrupt);
+}
+
+#if MBED_CONF_APP_DUAL_RATE
+/**************************************************************************/
+/*
+    Alarm: first conversion outside the wide no-persist window, runs in
+    the alarm thread
+*/
+/**************************************************************************/
+void onAlarm(uint8_t status, uint32_t lum) {
+  printf("ALARM (status %x)  ", status);
+  printLuminosity(lum);
+}
+
+/**************************************************************************/
+/*
+    Trend: the level stayed outside the persisted window, runs in the
+    main thread
+*/
+/**************************************************************************/
+void onTrend(uint8_t status, uint32_t lum) {
+  printf("Trend (status %x)  ", status);
+  printLuminosity(lum);
+#if MBED_CONF_APP_REPORT_ON_CHANGE
+  armChangeWindow(lum & 0xFFFF);
+#endif
+}
+#endif
+
 /**************************************************************************/
 /*
     Program entry point
@@ -146,9 +360,10 @@ int main() {
 
   printf("Starting Adafruit TSL2591 interrupt Test!\n");
 
-  if(!tsl.begin(i2c)) {
+  // Keep looking instead of hanging, a sensor on a glitching cable may answer later
+  while (!tsl.begin(i2c)) {
     printf("No sensor found ... check your wiring?\n");
-    while (1);
+    ThisThread::sleep_for(1s);
   }
 
   uint8_t id = tsl.getID();
@@ -159,10 +374,34 @@ int main() {
   /* Configure the sensor */
   configureSensor();
 
-  // Now we're ready to get readings ... move on to loop()!
-  while(true) { 
-    advancedRead();
-    getStatus();
-    thread_sleep_for(500);
-  }
+#if !MBED_CONF_APP_DUAL_RATE
+  // Defer the interrupt to the event queue, I2C must not be used in ISR context
+  tslInt.fall(queue.event(onSensorInterrupt));
+#endif
+  armSensor();
+
+#if MBED_CONF_APP_REPORT_ON_CHANGE
+  // Start with a window around the current level instead of the fixed one
+  uint16_t full;
+  do {
+    ThisThread::sleep_for(std::chrono::milliseconds(120 * (tsl.getTiming() + 1)));
+  } while (advancedRead(full));
+  armChangeWindow(full);
+#endif
+
+#if MBED_CONF_APP_DUAL_RATE
+  // Both windows are programmed and serviced independently
+  interrupts.setAlarmWindow(MBED_CONF_APP_ALARM_THRESHOLD_LOWER, MBED_CONF_APP_ALARM_THRESHOLD_UPPER);
+#if !MBED_CONF_APP_REPORT_ON_CHANGE
+  interrupts.setTrendWindow(TLS2591_INT_THRESHOLD_LOWER, TLS2591_INT_THRESHOLD_UPPER, TLS2591_INT_PERSIST);
+#endif
+  printf("Alarm Window: %d to %d\n", MBED_CONF_APP_ALARM_THRESHOLD_LOWER, MBED_CONF_APP_ALARM_THRESHOLD_UPPER);
+  interrupts.onAlarm(alarmQueue, onAlarm);
+  interrupts.onTrend(queue, onTrend);
+  alarmThread.start(callback(&alarmQueue, &EventQueue::dispatch_forever));
+  interrupts.start();
+#endif
+
+  // Now we're ready to get readings ... the main thread sleeps until INT fires
+  queue.dispatch_forever();
 }